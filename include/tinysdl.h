@@ -10,11 +10,32 @@
 #define TSDL_EXPORT __attribute__((visibility("default")))
 #endif
 
-#define TSDL_ERROR_SIZE 256 // Centralized size macro
-extern char err_trace[TSDL_ERROR_SIZE];
-static char logBuffer[128] = {0};
+#define TSDL_ERROR_SIZE 256 // Formatted getError text per thread
+#define TSDL_ERROR_RING 16  // Error records kept per thread (power of two)
 
-#define TSDL_INIT_VIDEO 0x0001 // Flag for video subsystem
+// Log levels; messages below TSDL_LOG_LEVEL compile to nothing
+#define TSDL_LOG_TRACE 0 // Per-event detail
+#define TSDL_LOG_DEBUG 1 // Lifecycle detail (LOG_STAT)
+#define TSDL_LOG_INFO 2  // Init and shutdown
+#define TSDL_LOG_WARN 3  // Recoverable problems
+#define TSDL_LOG_OFF 4   // Nothing
+#ifndef TSDL_LOG_LEVEL
+#ifdef TSDL_DEBUG
+#define TSDL_LOG_LEVEL TSDL_LOG_DEBUG
+#else
+#define TSDL_LOG_LEVEL TSDL_LOG_WARN
+#endif
+#endif
+
+#define TSDL_INIT_VIDEO 0x0001    // Flag for video subsystem
+#define TSDL_INIT_JOYSTICK 0x0002 // Flag for joystick subsystem
+#define TSDL_MAX_EVENT_WATCHES 8  // Event watch callbacks
+#define TSDL_QUERY -1             // eventState: report without changing
+#define TSDL_MAX_JOYSTICKS 8      // Joysticks open at once
+#define TSDL_JOY_MAX_AXES 8       // Axes tracked per joystick
+#define TSDL_JOY_MAX_BUTTONS 32   // Buttons tracked per joystick
+#define TSDL_TEXT_INPUT_SIZE 32   // Inline UTF-8 bytes per text event, NUL included
+#define TSDL_MAX_DISPLAYS 8       // Monitors tracked at once
 
 #define CORE_VER "0.1.0" // Core version
 #ifdef TSDL_BACKEND_X11
@@ -39,7 +60,30 @@ typedef enum
     TSDL_WINDOW_FULLSCREEN = 1 << 3,
     TSDL_WINDOW_CENTERED = 1 << 4,
     TSDL_WINDOW_MAXIMIZED = 1 << 5,
+    TSDL_WINDOW_EXCLUSIVE = 1 << 6, // Fullscreen takes over the monitor instead of covering it borderless
 } TSDL_WindowFlags;
+/** @brief Window display state, derived from the backend's window events */
+typedef enum
+{
+    TSDL_WINDOW_STATE_HIDDEN = 0, // Not mapped (and not minimized)
+    TSDL_WINDOW_STATE_NORMAL,     // Shown at its normal geometry
+    TSDL_WINDOW_STATE_MINIMIZED,  // Iconified
+    TSDL_WINDOW_STATE_MAXIMIZED,  // Maximized by the window manager
+    TSDL_WINDOW_STATE_FULLSCREEN, // Covering a monitor
+} TSDL_WindowState;
+/** @brief Window state machine and geometry; backends set the inputs, track_* report real changes */
+typedef struct
+{
+    int visible, minimized, maximized, fullscreen; // Inputs, as last reported by the backend
+    TSDL_WindowState state;                        // Current state
+    TSDL_WindowState shown;                        // Last non-hidden state reported to the app
+    int occluded;                                  // Fully covered by other windows (X11 only)
+    int x, y, w, h;                                // Current geometry
+    struct
+    {
+        int x, y, w, h; // Geometry while last NORMAL; the restore target
+    } normal;
+} TSDL_WindowTracker;
 /** @brief TinySDL Boolean type */
 typedef enum
 {
@@ -55,6 +99,21 @@ typedef enum
     TSDL_ERR_WINDOW = 0x03,
     TSDL_ERR_GL = 0x04,
 } TSDL_ErrorState;
+/** @brief A recorded error; msg and file point at static strings */
+typedef struct
+{
+    TSDL_ErrorState code;    // Error code
+    const char *msg;         // Message (string literal)
+    const char *file;        // Source file
+    int line;                // Source line
+    unsigned long long time; // Monotonic timestamp (ns)
+} TSDL_ErrorRecord;
+/** @brief Non-owning view of a string (NUL-terminated as well) */
+typedef struct
+{
+    const char *str; // Characters
+    size_t len;      // Length in bytes, excluding the terminator
+} TSDL_StringView;
 /** @brief TinySDL window event types */
 typedef enum
 {
@@ -75,6 +134,19 @@ typedef enum
     TSDL_EVENT_MOUSE_BUTTON_UP,
     TSDL_EVENT_MOUSE_MOVED,
     TSDL_EVENT_MOUSE_WHEEL,
+    TSDL_EVENT_MOUSE_RELATIVE,
+    TSDL_EVENT_JOY_ADDED,
+    TSDL_EVENT_JOY_REMOVED,
+    TSDL_EVENT_JOY_AXIS,
+    TSDL_EVENT_JOY_BUTTON_DOWN,
+    TSDL_EVENT_JOY_BUTTON_UP,
+    TSDL_EVENT_TEXT_INPUT,
+    TSDL_EVENT_WINDOW_OCCLUDED,    // Fully covered; the next TSDL_EVENT_WINDOW_EXPOSED ends it
+    TSDL_EVENT_DISPLAY_ADDED,      // Monitor connected
+    TSDL_EVENT_DISPLAY_REMOVED,    // Monitor disconnected
+    TSDL_EVENT_DISPLAY_CHANGED,    // Monitor moved, resized, or changed refresh rate or scale
+    TSDL_EVENT_USER = 0x8000,      // First application-defined event type
+    TSDL_EVENT_USER_LAST = 0xFFFF, // Last application-defined event type
 } TSDL_EventType;
 /** @brief TinySDL key modifier flags */
 typedef enum
@@ -114,8 +186,8 @@ typedef struct
         } window_moved; // Window moved event data
         struct
         {
-            list paths; // List of dropped file paths
-            int count;  // Number of dropped files
+            const TSDL_StringView *paths; // Dropped file paths; valid until the next pollEvent/waitEvent
+            int count;                    // Number of dropped files
         } drop;
         struct
         {
@@ -132,9 +204,67 @@ typedef struct
             double xoffset; // Horizontal scroll offset
             double yoffset; // Vertical scroll offset
         } mouse_wheel;      // Mouse wheel event data
-    } data;                 // Event data
+        struct
+        {
+            double dx;    // Horizontal motion since the last event (sub-pixel)
+            double dy;    // Vertical motion since the last event (sub-pixel)
+        } mouse_relative; // Relative mouse motion event data
+        struct
+        {
+            int code;     // Application-defined code
+            object data1; // Application-defined payload
+            object data2; // Application-defined payload
+        } user;           // User event data (TSDL_EVENT_USER..TSDL_EVENT_USER_LAST)
+        struct
+        {
+            int which;   // Joystick index
+            int axis;    // Axis index
+            float value; // Position, -1..1
+        } joy_axis;      // Joystick axis event data
+        struct
+        {
+            int which;  // Joystick index
+            int button; // Button index
+        } joy_button;   // Joystick button event data
+        struct
+        {
+            int which;  // Joystick index
+        } joy_device;   // Joystick added/removed event data
+        struct
+        {
+            int which; // Display index
+        } display;     // Display added/removed/changed event data
+        struct
+        {
+            char text[TSDL_TEXT_INPUT_SIZE]; // UTF-8, NUL-terminated; whole code points only
+        } text;                              // Text input event data (consecutive characters batched)
+    } data;               // Event data
 } TSDL_Event;
 typedef TSDL_Event *Event;
+/** @brief Polled joystick state */
+typedef struct
+{
+    int connected;                 // Device present
+    int axis_count;                // Axes reported (up to TSDL_JOY_MAX_AXES)
+    int button_count;              // Buttons reported (up to TSDL_JOY_MAX_BUTTONS)
+    float axes[TSDL_JOY_MAX_AXES]; // Positions, -1..1
+    unsigned int buttons;          // Bit per button, set while held
+    char name[64];                 // Device name
+} TSDL_JoystickState;
+/** @brief Monitor geometry and timing, in the desktop's coordinate space */
+typedef struct
+{
+    int connected;  // Monitor present
+    int primary;    // The desktop's primary monitor
+    int x, y, w, h; // Position and size of its current mode
+    double refresh; // Refresh rate in Hz (0 = unknown)
+    float scale;    // Content scale (1 = 96 dpi)
+    char name[64];  // Output name, e.g. "DP-1"
+} TSDL_DisplayInfo;
+/** @brief Backend joystick query used when evdev is unavailable; TSDL_FALSE if absent (index, state) */
+typedef int (*TSDL_JoystickFallback)(int, TSDL_JoystickState *);
+/** @brief Event filter/watch callback; a filter returns TSDL_FALSE to drop the event (watch results are ignored) */
+typedef int (*TSDL_EventFilter)(object user, TSDL_Event *event);
 /** @brief Keycode definitions. */
 typedef enum
 {
@@ -246,28 +376,59 @@ typedef enum
 } TSDL_Keycode;
 
 // Shared Helper Declarations =================================================
-TSDL_ErrorState log_error(TSDL_ErrorState, const string);
-void log_stat(const string);
+TSDL_ErrorState record_error(TSDL_ErrorState, const char *, const char *, int);
+const string get_error(void);
+const TSDL_ErrorRecord *last_error(void);
+void clear_error(void);
+void log_write(int, const char *, ...) __attribute__((format(printf, 2, 3)));
 
-list copy_drop_paths(int, const char **);
+TSDL_StringView *copy_drop_paths(int, const char **);
+TSDL_StringView *pack_drop_paths(int, const char *, size_t);
 void clear_drop_paths(Event);
+int utf8_encode(unsigned int, char *);
+int append_text(Event, const char *, int);
+void track_init(TSDL_WindowTracker *, int, int, int, int, int);
+int track_state(TSDL_WindowTracker *, Event);
+int track_geometry(TSDL_WindowTracker *, int, int, int, int, Event);
+int track_visible(const TSDL_WindowTracker *);
 int map_key_mods(int);
 Event create_event(TSDL_EventType);
+int event_enabled(TSDL_EventType);
+int dispatch_event(Event);
+int post_event(const TSDL_Event *);
+int poll_posted_event(Event);
+void clear_posted_events(void);
+void record_event(const TSDL_Event *);
+int record_events(const char *);
+int replay_events(const char *, double);
+int replay_active(void);
+int replay_next(Event);
+int replay_wait_ms(void);
+int joystick_init(TSDL_JoystickFallback);
+void joystick_quit(void);
+int joystick_active(void);
+int joystick_poll(Event);
+int joystick_state(int, TSDL_JoystickState *);
+void display_update(const TSDL_DisplayInfo *, int);
+void display_quit(void);
+int display_state(int, TSDL_DisplayInfo *);
+int display_at(int, int);
+int display_event(TSDL_EventType);
 
-#ifdef TSDL_DEBUG
-// Variadic macro to handle both cases
-#define LOG_STAT(fmt, ...)                      \
-    do                                          \
-    {                                           \
-        sprintf(logBuffer, fmt, ##__VA_ARGS__); \
-        log_stat(logBuffer);                    \
-    } while (0)
-#else
-#define LOG_STAT(fmt, ...) \
-    do                     \
-    {                      \
+// Records into the calling thread's error ring; msg must outlive the thread (a literal)
+#define log_error(state, msg) record_error((state), (msg), __FILE__, __LINE__)
+
+// Queued to the async log sink; the level check folds away at compile time
+#define TSDL_LOG(level, fmt, ...)                   \
+    do                                              \
+    {                                               \
+        if ((level) >= TSDL_LOG_LEVEL)              \
+            log_write((level), fmt, ##__VA_ARGS__); \
     } while (0)
-#endif
+#define LOG_TRACE(fmt, ...) TSDL_LOG(TSDL_LOG_TRACE, fmt, ##__VA_ARGS__)
+#define LOG_STAT(fmt, ...) TSDL_LOG(TSDL_LOG_DEBUG, fmt, ##__VA_ARGS__)
+#define LOG_INFO(fmt, ...) TSDL_LOG(TSDL_LOG_INFO, fmt, ##__VA_ARGS__)
+#define LOG_WARN(fmt, ...) TSDL_LOG(TSDL_LOG_WARN, fmt, ##__VA_ARGS__)
 
 //  Interfaces ================================================================
 /** @brief Interface for the Window */
@@ -283,6 +444,12 @@ typedef struct IWindow
     void (*toggleFullscreen)(window);
     /** @brief Get GL context (for OpenGL users)*/
     object (*getGLContext)(window);
+    /** @brief Lock and hide the pointer and report raw TSDL_EVENT_MOUSE_RELATIVE deltas instead of positions */
+    int (*setRelativeMouse)(window, int);
+    /** @brief TSDL_TRUE while any of the window can be seen (mapped, not minimized, not fully occluded) */
+    int (*isVisible)(window);
+    /** @brief Index of the monitor under the window's centre (-1 if no monitor is known) */
+    int (*getDisplay)(window);
 } IWindow;
 /** @brief Interface for TinySDL core functionality */
 typedef struct ITinySDL
@@ -291,12 +458,38 @@ typedef struct ITinySDL
     const IWindow *window;
     /** @brief Initialize TinySDL with video subsystem */
     int (*init_video)(void);
+    /** @brief Initialize the subsystems in flags (TSDL_INIT_VIDEO | TSDL_INIT_JOYSTICK) */
+    int (*init)(int flags);
     /** @brief Shut down TinySDL and free resources */
     void (*quit)(void);
     /** @brief Run polling loop */
     int (*pollEvent)(TSDL_Event *event);
-    /** @brief Get the last error message */
+    /** @brief Block until an event arrives or timeout ms elapse (-1 = no timeout) */
+    int (*waitEvent)(TSDL_Event *event, int timeout);
+    /** @brief Post an event to the queue; safe to call from any thread */
+    int (*pushEvent)(const TSDL_Event *event);
+    /** @brief Enable (TSDL_TRUE) or disable (TSDL_FALSE) a built-in event type at the source, or TSDL_QUERY; returns the previous state */
+    int (*eventState)(TSDL_EventType type, int state);
+    /** @brief Set (or clear with NULL) the filter run on every event as it is captured (pushed events: on the posting thread) */
+    void (*setEventFilter)(TSDL_EventFilter filter, object user);
+    /** @brief Add a callback that observes every event that passes the filter */
+    int (*addEventWatch)(TSDL_EventFilter watch, object user);
+    /** @brief Remove an event watch added with the same callback and user data */
+    void (*removeEventWatch)(TSDL_EventFilter watch, object user);
+    /** @brief Copy a joystick's polled state; TSDL_FALSE if nothing is connected at index */
+    int (*getJoystickState)(int index, TSDL_JoystickState *state);
+    /** @brief Copy a monitor's geometry, refresh rate and scale; TSDL_FALSE if nothing is connected at index */
+    int (*getDisplay)(int index, TSDL_DisplayInfo *info);
+    /** @brief Record every delivered event to a binary log at path (NULL stops) */
+    int (*recordEvents)(const char *path);
+    /** @brief Feed a recorded log back through pollEvent/waitEvent at speed x (<= 0 = as fast as polled; NULL path stops) */
+    int (*replayEvents)(const char *path, double speed);
+    /** @brief Get this thread's recent errors, oldest first */
     const string (*getError)(void);
+    /** @brief Get this thread's most recent error record (NULL if none) */
+    const TSDL_ErrorRecord *(*lastError)(void);
+    /** @brief Forget this thread's errors */
+    void (*clearError)(void);
     /** @brief Get the core version + backend version info */
     const string (*getVersion)(void);
 } ITinySDL;
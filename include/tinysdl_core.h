@@ -6,11 +6,16 @@
 
 #define DEFAULT_EVQUEUE_SIZE 16
 
-int tsdl_init_video(void);          // Initialize TinySDL (only has video subsystem)
-void tsdl_quit(void);               // Quit TinySDL
-const string tsdl_getError(void);   // Get the last error message
-int tsdl_pollEvent(TSDL_Event *);   // Poll for events
-const string tsdl_getVersion(void); // Get the core version + backend version info
+int tsdl_init_video(void);             // Initialize TinySDL (only has video subsystem)
+void tsdl_quit(void);                  // Quit TinySDL
+int tsdl_pollEvent(TSDL_Event *);      // Poll for events
+int tsdl_waitEvent(TSDL_Event *, int); // Wait for an event (timeout ms, -1 = forever)
+void tsdl_wakeEvents(void);            // Wake a blocked tsdl_waitEvent (any thread)
+void tsdl_updateEventMask(void);       // Re-apply enabled event types to the backend
+const string tsdl_getVersion(void);    // Get the core version + backend version info
+
+// Joystick functions
+int tsdl_getJoystickFallback(int, TSDL_JoystickState *); // Backend joystick state when evdev is unavailable (index)
 
 // Window functions
 window window_create(string, int, int, int, int, int); // Create a window (title, x, y, w, h, flags)
@@ -18,5 +23,8 @@ void window_close(window);                             // Close a window
 void window_destroy(window);                           // Destroy a window
 void window_toggleFullscreen(window);                  // Toggle fullscreen mode
 object window_getGLContext(window);                    // Get OpenGL context
+int window_setRelativeMouse(window, int);              // Enable/disable relative mouse mode
+int window_isVisible(window);                          // Whether any of the window can be seen
+int window_getDisplay(window);                         // Index of the monitor the window is on
 
 #endif // TINY_SDL_CORE_H
\ No newline at end of file
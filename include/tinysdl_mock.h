@@ -5,10 +5,14 @@
 #include "tinysdl.h"
 
 // tinysdl mocks
-int mock_init(int);               // Mock initialization function (flags)
-void mock_quit(void);             // Mock quit function
-const string mock_getError(void); // Mock error retrieval function
-int mock_pollEvent(TSDL_Event *); // Mock event polling function (*event)
+int mock_init(int);                    // Mock initialization function (flags)
+int mock_init_video(void);             // Mock video initialization function
+void mock_quit(void);                  // Mock quit function
+int mock_pollEvent(TSDL_Event *);      // Mock event polling function (*event)
+int mock_waitEvent(TSDL_Event *, int); // Mock event wait function (*event, timeout)
+void mock_wakeEvents(void);            // Mock wake function
+void mock_updateEventMask(void);       // Mock event mask update function
+const string mock_getVersion(void);    // Mock version info
 
 // window mocks
 window mock_create(string, int, int, int, int, int); // Mock window creation function (title, x, y, w, h, flags)
@@ -16,5 +20,8 @@ void mock_close(window);                             // Mock window close functi
 void mock_destroy(window);                           // Mock window destroy function (window)
 void mock_toggleFullscreen(window);                  // Mock toggle fullscreen function (window)
 object mock_getGLContext(window);                    // Mock get GL context function (window)
+int mock_setRelativeMouse(window, int);              // Mock relative mouse function (window, enabled)
+int mock_isVisible(window);                          // Mock visibility query (window)
+int mock_getDisplay(window);                         // Mock display query (window)
 
 #endif // TINY_SDL_MOCK_H
\ No newline at end of file
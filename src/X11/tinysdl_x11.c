@@ -1,13 +1,21 @@
 //  src/X11/tinysdl_x11.c
 #include "tinysdl.h"
 #include "tinysdl_core.h"
+#include "../internal/tsdl_gl.h"
 #include <X11/Xlib.h>
 #include <X11/XKBlib.h>
 #include <X11/Xutil.h>
 #include <X11/Xatom.h>
+#include <X11/extensions/XInput2.h>
+#include <X11/extensions/Xrandr.h>
 #include <GL/glx.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 //  internal
 #include "../internal/tsdl_rendering.h"
 
@@ -18,6 +26,9 @@
 #define TSDL_VER CORE_VER "+" BACKEND_ID "_" BACKEND_VER
 #endif
 
+#define TEXT_STAGING 512 // UTF-8 staged across a burst of key events
+#define TEXT_LOOKUP 64   // Room kept free for one key's lookup
+
 const string WM_DELETE_WINDOW = "WM_DELETE_WINDOW";
 
 struct tinysdl_window_s
@@ -25,24 +36,95 @@ struct tinysdl_window_s
     Display *display;
     Window xwindow;
     GLXContext glx_context;
-    int w, h;            // Track size
-    int x, y;            // Track position
-    int is_fullscreen;   // Fullscreen state
-    int close_requested; // Quit flag
-    struct
-    {
-        int w, h, x, y; // Restore state
-    } resto;
+    TSDL_WindowTracker track; // State and geometry, driven by window events
+    int close_requested;      // Quit flag
+    int relative;             // Relative mouse mode (pointer grabbed)
+    double rel_dx, rel_dy;    // Relative motion accumulated since the last event
+    XIC xic;                  // Input context (NULL = keysym fallback)
 };
 
 static Display *global_display = NULL;
 static Atom wm_delete_window = None;
 static int is_initialized = TSDL_FALSE;
-static window active_window = NULL; // Track current window
-static int mod_state = TSDL_MOD_NONE;
+static window active_window = NULL;   // Track current window
+static int mod_state = TSDL_MOD_NONE; // TSDL_MOD_* held; key events, XKB state and focus keep it current
+static int wake_pipe[2] = {-1, -1};   // Self-pipe that wakes tsdl_waitEvent
+static int xi_opcode = -1;            // XInput2 extension opcode (-1 = unavailable)
+static int randr_event = -1;          // XRandR event base (-1 = default screen only)
+static Cursor invisible_cursor = None;
+static XIM input_method = NULL;       // Compose/IME handling (NULL = keysym fallback)
+static long im_events = 0;            // Events the input method needs to see
+static PFNGLXGETSYNCVALUESOMLPROC get_sync_values = NULL; // GLX_OML_sync_control (NULL = CPU timing estimate)
+static PFNGLXCREATECONTEXTATTRIBSARBPROC create_context_attribs = NULL; // GLX_ARB_create_context_profile (NULL = legacy context)
+static int context_refused = TSDL_FALSE; // The server rejected a context request
+
+static struct
+{
+    TSDL_Keycode keys[256];  // X keycode -> TSDL key for the active layout
+    unsigned char mods[256]; // X keycode -> TSDL_MOD_* bit the key holds
+    int group;               // XKB group (layout) the tables were built for
+    int xkb_event;           // XKB event base (-1 = core keyboard mapping only)
+} keymap = {.xkb_event = -1};
+
+static struct
+{
+    char buf[TEXT_STAGING]; // Looked up but not yet delivered
+    int len;                // Bytes staged
+} text = {0};
+
+static struct
+{
+    Atom wm_state;   // ICCCM WM_STATE (IconicState while minimized)
+    Atom net_state;  // _NET_WM_STATE
+    Atom fullscreen; // _NET_WM_STATE_FULLSCREEN
+    Atom max_horz;   // _NET_WM_STATE_MAXIMIZED_HORZ
+    Atom max_vert;   // _NET_WM_STATE_MAXIMIZED_VERT
+    Atom hidden;     // _NET_WM_STATE_HIDDEN
+    Atom bypass;     // _NET_WM_BYPASS_COMPOSITOR
+} wm = {0};
+
+/** @brief Decoded text/uri-list: NUL-separated local paths, built while the transfer streams in */
+typedef struct
+{
+    char *buf;         // Decoded paths
+    size_t len, cap;   // Bytes used / allocated
+    size_t line;       // Start of the line being decoded
+    int count;         // Completed paths
+    int pct;           // Hex digits seen after a '%' (-1 = not in an escape)
+    int hi;            // First hex digit of an escape
+    int skip;          // Dropping the line ('#' comment or a path with an escaped NUL)
+} uri_parser;
+
+static struct
+{
+    Atom aware, enter, position, status, leave, drop, finished; // Protocol messages
+    Atom selection, action_copy, type_list, uri_list, incr;     // Selection/transfer atoms
+    Atom property;                                              // Property the selection is converted into
+    Window source;                                              // Drag source (None = no drag)
+    int version;                                                // Source protocol version
+    int accept;                                                 // Source offers text/uri-list
+    int incr_active;                                            // INCR transfer in progress
+    uri_parser parser;                                          // Streaming uri-list decoder
+} xdnd = {0};
 
 // TSDL (X11) Functions =======================================================
 static TSDL_Keycode map_keys(KeySym);
+static void make_current(window);
+static long event_mask(void);
+static void accumulate_raw_motion(window, XEvent *);
+static void build_keymap(void);
+static int held_mods(void);
+static int mask_mods(int, unsigned int);
+static void keymap_notify(XEvent *);
+static void lookup_text(window, XKeyEvent *);
+static int read_wm_state(window, Atom);
+static int poll_text(Event);
+static void refresh_displays(void);
+static GLXContext create_context(Display *, Window);
+static void uri_reset(uri_parser *);
+static int xdnd_client_message(window, XClientMessageEvent *);
+static int xdnd_selection_notify(window, XSelectionEvent *, Event);
+static int xdnd_property_notify(window, XPropertyEvent *, Event);
 
 int tsdl_init_video(void)
 {
@@ -50,6 +132,8 @@ int tsdl_init_video(void)
     {
         return log_error(TSDL_ERR_INIT, "TinySDL is already initialized");
     }
+    // the display is shared with the render thread (swaps), if one is started
+    XInitThreads();
     global_display = XOpenDisplay(NULL);
     if (!global_display)
     {
@@ -66,9 +150,97 @@ int tsdl_init_video(void)
     }
     LOG_STAT("WM_DELETE_WINDOW interned"); // Debug
 
+    // window state comes from property changes; the atoms are interned once
+    wm.wm_state = XInternAtom(global_display, "WM_STATE", TSDL_FALSE);
+    wm.net_state = XInternAtom(global_display, "_NET_WM_STATE", TSDL_FALSE);
+    wm.fullscreen = XInternAtom(global_display, "_NET_WM_STATE_FULLSCREEN", TSDL_FALSE);
+    wm.max_horz = XInternAtom(global_display, "_NET_WM_STATE_MAXIMIZED_HORZ", TSDL_FALSE);
+    wm.max_vert = XInternAtom(global_display, "_NET_WM_STATE_MAXIMIZED_VERT", TSDL_FALSE);
+    wm.hidden = XInternAtom(global_display, "_NET_WM_STATE_HIDDEN", TSDL_FALSE);
+    wm.bypass = XInternAtom(global_display, "_NET_WM_BYPASS_COMPOSITOR", TSDL_FALSE);
+
+    xdnd.aware = XInternAtom(global_display, "XdndAware", TSDL_FALSE);
+    xdnd.enter = XInternAtom(global_display, "XdndEnter", TSDL_FALSE);
+    xdnd.position = XInternAtom(global_display, "XdndPosition", TSDL_FALSE);
+    xdnd.status = XInternAtom(global_display, "XdndStatus", TSDL_FALSE);
+    xdnd.leave = XInternAtom(global_display, "XdndLeave", TSDL_FALSE);
+    xdnd.drop = XInternAtom(global_display, "XdndDrop", TSDL_FALSE);
+    xdnd.finished = XInternAtom(global_display, "XdndFinished", TSDL_FALSE);
+    xdnd.selection = XInternAtom(global_display, "XdndSelection", TSDL_FALSE);
+    xdnd.action_copy = XInternAtom(global_display, "XdndActionCopy", TSDL_FALSE);
+    xdnd.type_list = XInternAtom(global_display, "XdndTypeList", TSDL_FALSE);
+    xdnd.uri_list = XInternAtom(global_display, "text/uri-list", TSDL_FALSE);
+    xdnd.incr = XInternAtom(global_display, "INCR", TSDL_FALSE);
+    xdnd.property = XInternAtom(global_display, "TSDL_XDND_DATA", TSDL_FALSE);
+
+    int xi_event, xi_error, xi_major = 2, xi_minor = 0;
+    if (!XQueryExtension(global_display, "XInputExtension", &xi_opcode, &xi_event, &xi_error) ||
+        XIQueryVersion(global_display, &xi_major, &xi_minor) != Success)
+    {
+        xi_opcode = -1;
+        LOG_WARN("XInput2 unavailable; relative mouse uses core motion");
+    }
+
+    if (pipe(wake_pipe) != 0)
+    {
+        XCloseDisplay(global_display);
+        global_display = NULL;
+        return log_error(TSDL_ERR_INIT, "Failed to create event wake pipe");
+    }
+    for (int i = 0; i < 2; i++)
+    {
+        fcntl(wake_pipe[i], F_SETFL, O_NONBLOCK);
+        fcntl(wake_pipe[i], F_SETFD, FD_CLOEXEC);
+    }
+    // key translation is a table lookup; XKB tells us when the layout changes
+    int xkb_opcode, xkb_error, xkb_major = XkbMajorVersion, xkb_minor = XkbMinorVersion;
+    if (XkbQueryExtension(global_display, &xkb_opcode, &keymap.xkb_event, &xkb_error, &xkb_major, &xkb_minor))
+    {
+        unsigned int notify = XkbNewKeyboardNotifyMask | XkbMapNotifyMask;
+        XkbSelectEvents(global_display, XkbUseCoreKbd, notify, notify);
+        unsigned long state = XkbGroupStateMask | XkbModifierStateMask;
+        XkbSelectEventDetails(global_display, XkbUseCoreKbd, XkbStateNotify, state, state);
+    }
+    else
+    {
+        keymap.xkb_event = -1;
+        LOG_WARN("XKB unavailable; layout switches won't update key translation");
+    }
+    // monitors come from XRandR 1.2 outputs; plugging and mode changes re-enumerate them
+    int randr_error, randr_major = 1, randr_minor = 2;
+    if (XRRQueryExtension(global_display, &randr_event, &randr_error) &&
+        XRRQueryVersion(global_display, &randr_major, &randr_minor) && (randr_major > 1 || randr_minor >= 2))
+    {
+        XRRSelectInput(global_display, DefaultRootWindow(global_display),
+                       RRScreenChangeNotifyMask | RRCrtcChangeNotifyMask | RROutputChangeNotifyMask);
+    }
+    else
+    {
+        randr_event = -1;
+        LOG_WARN("XRandR 1.2 unavailable; the default screen is the only display");
+    }
+    refresh_displays();
+    // present timestamps, where the driver has them
+    const char *glx_extensions = glXQueryExtensionsString(global_display, DefaultScreen(global_display));
+    if (glx_extensions && strstr(glx_extensions, "GLX_OML_sync_control"))
+        get_sync_values = (PFNGLXGETSYNCVALUESOMLPROC)glXGetProcAddressARB((const GLubyte *)"glXGetSyncValuesOML");
+    if (!get_sync_values)
+        LOG_WARN("GLX_OML_sync_control unavailable; frame timing is a CPU estimate");
+    // the renderer's shaders are GLSL 3.30, which needs a core profile context
+    if (glx_extensions && strstr(glx_extensions, "GLX_ARB_create_context_profile"))
+        create_context_attribs = (PFNGLXCREATECONTEXTATTRIBSARBPROC)glXGetProcAddressARB((const GLubyte *)"glXCreateContextAttribsARB");
+    if (!create_context_attribs)
+        LOG_WARN("GLX_ARB_create_context_profile unavailable; the renderer needs an OpenGL 3.3 core context");
+    build_keymap();
+    // the locale's compose table and any running IME (XMODIFIERS) come through the input method
+    if (XSupportsLocale() && XSetLocaleModifiers(""))
+        input_method = XOpenIM(global_display, NULL, NULL, NULL);
+    if (!input_method)
+        LOG_WARN("No X input method; text input is limited to plain keysyms");
+
     is_initialized = TSDL_TRUE;
 
-    LOG_STAT("Initialized Backend (%s): flags=%d", TSDL_BACKEND, TSDL_INIT_VIDEO);
+    LOG_INFO("Initialized Backend (%s): flags=%d", TSDL_BACKEND, TSDL_INIT_VIDEO);
 
     return TSDL_ERR_NONE;
 }
@@ -86,17 +258,32 @@ void tsdl_quit(void)
     }
     if (global_display)
     {
+        if (invisible_cursor != None)
+            XFreeCursor(global_display, invisible_cursor);
+        invisible_cursor = None;
+        if (input_method)
+            XCloseIM(input_method);
+        input_method = NULL;
+        im_events = 0;
+        keymap.xkb_event = -1;
         XCloseDisplay(global_display);
         global_display = NULL;
     }
-
     is_initialized = TSDL_FALSE;
+    close(wake_pipe[0]);
+    close(wake_pipe[1]);
+    wake_pipe[0] = wake_pipe[1] = -1;
+    uri_reset(&xdnd.parser);
+    xdnd.source = None;
+    text.len = 0;
+    clear_posted_events();
 
-    LOG_STAT("Quit %s Backend", TSDL_BACKEND);
+    LOG_INFO("Quit %s Backend", TSDL_BACKEND);
 }
-const string tsdl_getError(void)
+int tsdl_getJoystickFallback(int index, TSDL_JoystickState *state)
 {
-    return err_trace;
+    // Xlib has no joystick API; joystick_init is given no fallback here, so this isn't polled
+    return TSDL_FALSE;
 }
 int tsdl_pollEvent(Event event)
 {
@@ -104,15 +291,44 @@ int tsdl_pollEvent(Event event)
         return TSDL_FALSE;
     if (!global_display)
         return TSDL_FALSE; // Safety check
+    if (poll_text(event))
+        return TSDL_TRUE;
 
     if (XPending(global_display))
     {
         XEvent xev;
         XNextEvent(global_display, &xev);
+        if (XFilterEvent(&xev, None))
+            return TSDL_FALSE; // part of a compose sequence or IME preedit
 
         // Single-window assumption
         window win = active_window;
-        if (!win || xev.xany.window != win->xwindow)
+        if (xev.type == GenericEvent)
+        {
+            // raw motion is delivered to the root window; fold a whole burst into one event
+            accumulate_raw_motion(win, &xev);
+            XEvent next;
+            while (XPending(global_display))
+            {
+                XPeekEvent(global_display, &next);
+                if (next.type != GenericEvent || next.xcookie.extension != xi_opcode || next.xcookie.evtype != XI_RawMotion)
+                    break;
+                XNextEvent(global_display, &next);
+                accumulate_raw_motion(win, &next);
+            }
+        }
+        else if (xev.type == MappingNotify || (keymap.xkb_event >= 0 && xev.type == keymap.xkb_event))
+        {
+            keymap_notify(&xev);
+            return TSDL_FALSE;
+        }
+        else if (randr_event >= 0 && (xev.type == randr_event + RRScreenChangeNotify || xev.type == randr_event + RRNotify))
+        {
+            XRRUpdateConfiguration(&xev);
+            refresh_displays();
+            return TSDL_FALSE;
+        }
+        else if (!win || xev.xany.window != win->xwindow)
             return TSDL_FALSE;
 
         event->type = TSDL_EVENT_NONE; // Reset event type
@@ -120,15 +336,17 @@ int tsdl_pollEvent(Event event)
         {
         case ClientMessage:
         {
-            LOG_STAT("ClientMessage received: atom=%ld, expected=%ld",
+            LOG_TRACE("ClientMessage received: atom=%ld, expected=%ld",
                      (long)xev.xclient.data.l[0], (long)wm_delete_window);
 
+            if (xdnd_client_message(win, &xev.xclient))
+                break;
             if ((Atom)xev.xclient.data.l[0] == wm_delete_window)
             {
                 event->type = TSDL_EVENT_QUIT;
                 win->close_requested = TSDL_TRUE;
 
-                LOG_STAT("Quit event set: type=%d", event->type);
+                LOG_TRACE("Quit event set: type=%d", event->type);
                 // Log exact type
             }
         }
@@ -136,75 +354,45 @@ int tsdl_pollEvent(Event event)
         break;
         case FocusIn:
         {
+            // modifiers pressed or released while another window had focus
+            mod_state = held_mods();
+            if (win->xic)
+                XSetICFocus(win->xic);
             event->type = TSDL_EVENT_WINDOW_FOCUS_GAINED;
         }
 
         break;
         case FocusOut:
         {
+            if (win->xic)
+                XUnsetICFocus(win->xic);
             event->type = TSDL_EVENT_WINDOW_FOCUS_LOST;
         }
 
         break;
         case ConfigureNotify:
         {
-            Atom wm_state = XInternAtom(global_display, "_NET_WM_STATE", TSDL_FALSE);
-            Atom max_horz = XInternAtom(global_display, "_NET_WM_STATE_MAXIMIZED_HORZ", TSDL_FALSE);
-            Atom max_vert = XInternAtom(global_display, "_NET_WM_STATE_MAXIMIZED_VERT", TSDL_FALSE);
-            Atom type;
-            int format;
-            unsigned long nitems, bytes_after;
-            unsigned char *prop = NULL;
-
-            if (XGetWindowProperty(global_display, win->xwindow, wm_state, 0, 1024, TSDL_FALSE,
-                                   XA_ATOM, &type, &format, &nitems, &bytes_after, &prop) == Success &&
-                prop)
-            {
-                Atom *states = (Atom *)prop;
-                int maximized = TSDL_FALSE;
-                for (unsigned long i = 0; i < nitems; i++)
-                {
-                    if (states[i] == max_horz || states[i] == max_vert)
-                    {
-                        maximized = TSDL_TRUE;
-                        break;
-                    }
-                }
-                if (maximized && !win->is_fullscreen)
-                {
-                    event->type = TSDL_EVENT_WINDOW_MAXIMIZED;
-                }
-                XFree(prop);
-            }
-            if (xev.xconfigure.width != win->w || xev.xconfigure.height != win->h)
-            {
-                event->type = TSDL_EVENT_WINDOW_RESIZED;
-                event->data.window_resized.w = xev.xconfigure.width;
-                event->data.window_resized.h = xev.xconfigure.height;
-                event->data.window_resized.is_fullscreen = win->is_fullscreen;
-            }
-            else if (xev.xconfigure.x != win->x || xev.xconfigure.y != win->y)
-            {
-                event->type = TSDL_EVENT_WINDOW_MOVED;
-                event->data.window_moved.x = xev.xconfigure.x;
-                event->data.window_moved.y = xev.xconfigure.y;
-            }
-            win->w = xev.xconfigure.width;
-            win->h = xev.xconfigure.height;
-            win->x = xev.xconfigure.x;
-            win->y = xev.xconfigure.y;
+            // geometry only; state changes arrive as property changes
+            track_geometry(&win->track, xev.xconfigure.x, xev.xconfigure.y,
+                           xev.xconfigure.width, xev.xconfigure.height, event);
         }
 
         break;
         case MapNotify:
+        case UnmapNotify:
         {
-            event->type = TSDL_EVENT_WINDOW_RESTORED;
+            win->track.visible = xev.type == MapNotify;
+            track_state(&win->track, event);
         }
 
         break;
-        case UnmapNotify:
+        case VisibilityNotify:
         {
-            event->type = TSDL_EVENT_WINDOW_MINIMIZED;
+            int occluded = xev.xvisibility.state == VisibilityFullyObscured;
+            // uncovering is reported by the Expose that follows
+            if (occluded && !win->track.occluded)
+                event->type = TSDL_EVENT_WINDOW_OCCLUDED;
+            win->track.occluded = occluded;
         }
 
         break;
@@ -216,81 +404,27 @@ int tsdl_pollEvent(Event event)
         break;
         case KeyPress:
         {
-            KeySym x11_key = XkbKeycodeToKeysym(global_display, xev.xkey.keycode, 0, xev.xkey.state & ShiftMask ? 1 : 0);
-            TSDL_Keycode key = map_keys(x11_key);
+            unsigned int keycode = xev.xkey.keycode & 0xFF;
             event->type = TSDL_EVENT_KEY_DOWN;
-            event->data.key.keycode = key;
+            event->data.key.keycode = keymap.keys[keycode];
             event->data.key.repeat = (xev.xkey.state & 0x1000) ? 1 : 0;
-            // Update modifier state
-            switch (x11_key)
-            {
-            case XK_Shift_L:
-                mod_state |= TSDL_MOD_LSHIFT;
-                break;
-            case XK_Shift_R:
-                mod_state |= TSDL_MOD_RSHIFT;
-                break;
-            case XK_Control_L:
-                mod_state |= TSDL_MOD_LCTRL;
-                break;
-            case XK_Control_R:
-                mod_state |= TSDL_MOD_RCTRL;
-                break;
-            case XK_Alt_L:
-                mod_state |= TSDL_MOD_LALT;
-                break;
-            case XK_Alt_R:
-                mod_state |= TSDL_MOD_RALT;
-                break;
-            case XK_Super_L:
-                mod_state |= TSDL_MOD_LSUPER;
-                break;
-            case XK_Super_R:
-                mod_state |= TSDL_MOD_RSUPER;
-                break;
-            }
-            event->data.key.mods = map_key_mods(xev.xkey.state);
-            LOG_STAT("Key down: keycode=%d, mods=0x%x", event->data.key.keycode, event->data.key.mods);
+            mod_state |= keymap.mods[keycode];
+            event->data.key.mods = mod_state;
+            if (event_enabled(TSDL_EVENT_TEXT_INPUT))
+                lookup_text(win, &xev.xkey); // delivered after the key events of this burst
+            LOG_TRACE("Key down: keycode=%d, mods=0x%x", event->data.key.keycode, event->data.key.mods);
         }
 
         break;
         case KeyRelease:
         {
-            KeySym x11_key = XkbKeycodeToKeysym(global_display, xev.xkey.keycode, 0, xev.xkey.state & ShiftMask ? 1 : 0);
-            TSDL_Keycode key = map_keys(x11_key);
+            unsigned int keycode = xev.xkey.keycode & 0xFF;
             event->type = TSDL_EVENT_KEY_UP;
-            event->data.key.keycode = key;
+            event->data.key.keycode = keymap.keys[keycode];
             event->data.key.repeat = 0;
-            // Update modifier state
-            switch (x11_key)
-            {
-            case XK_Shift_L:
-                mod_state &= ~TSDL_MOD_LSHIFT;
-                break;
-            case XK_Shift_R:
-                mod_state &= ~TSDL_MOD_RSHIFT;
-                break;
-            case XK_Control_L:
-                mod_state &= ~TSDL_MOD_LCTRL;
-                break;
-            case XK_Control_R:
-                mod_state &= ~TSDL_MOD_RCTRL;
-                break;
-            case XK_Alt_L:
-                mod_state &= ~TSDL_MOD_LALT;
-                break;
-            case XK_Alt_R:
-                mod_state &= ~TSDL_MOD_RALT;
-                break;
-            case XK_Super_L:
-                mod_state &= ~TSDL_MOD_LSUPER;
-                break;
-            case XK_Super_R:
-                mod_state &= ~TSDL_MOD_RSUPER;
-                break;
-            }
-            event->data.key.mods = map_key_mods(xev.xkey.state);
-            LOG_STAT("Key up: keycode=%d, mods=0x%x", event->data.key.keycode, event->data.key.mods);
+            mod_state &= ~keymap.mods[keycode];
+            event->data.key.mods = mod_state;
+            LOG_TRACE("Key up: keycode=%d, mods=0x%x", event->data.key.keycode, event->data.key.mods);
         }
 
         break;
@@ -321,23 +455,62 @@ int tsdl_pollEvent(Event event)
             }
         }
 
+        break;
+        case SelectionNotify:
+        {
+            xdnd_selection_notify(win, &xev.xselection, event);
+        }
+
+        break;
+        case PropertyNotify:
+        {
+            if (read_wm_state(win, xev.xproperty.atom))
+                track_state(&win->track, event);
+            else
+                xdnd_property_notify(win, &xev.xproperty, event);
+        }
+
         break;
         case MotionNotify:
         {
-            event->type = TSDL_EVENT_MOUSE_MOVED;
-            event->data.mouse_moved.x = xev.xmotion.x;
-            event->data.mouse_moved.y = xev.xmotion.y;
+            if (!win->relative)
+            {
+                event->type = TSDL_EVENT_MOUSE_MOVED;
+                event->data.mouse_moved.x = xev.xmotion.x;
+                event->data.mouse_moved.y = xev.xmotion.y;
+            }
+            else if (xi_opcode < 0)
+            {
+                // no XInput2: measure from the window centre and warp back (accelerated, whole pixels)
+                int cx = win->track.w / 2, cy = win->track.h / 2;
+                if (xev.xmotion.x != cx || xev.xmotion.y != cy)
+                {
+                    win->rel_dx += xev.xmotion.x - cx;
+                    win->rel_dy += xev.xmotion.y - cy;
+                    XWarpPointer(win->display, None, win->xwindow, 0, 0, 0, 0, cx, cy);
+                }
+            }
         }
 
         break;
         }
 
-        if (event->type != TSDL_EVENT_NONE)
+        if (event->type == TSDL_EVENT_NONE && win && (win->rel_dx != 0 || win->rel_dy != 0))
         {
-            LOG_STAT("Event type set: %d", event->type);
+            event->type = TSDL_EVENT_MOUSE_RELATIVE;
+            event->data.mouse_relative.dx = win->rel_dx;
+            event->data.mouse_relative.dy = win->rel_dy;
+            win->rel_dx = win->rel_dy = 0;
+        }
+
+        // filtered and watched as soon as it is translated
+        if (event->type != TSDL_EVENT_NONE && dispatch_event(event))
+        {
+            LOG_TRACE("Event type set: %d", event->type);
             // Confirm event type
             return TSDL_TRUE;
         }
+        clear_drop_paths(event); // a filtered drop releases its payload
     }
 
     if (active_window && active_window->close_requested)
@@ -345,13 +518,68 @@ int tsdl_pollEvent(Event event)
         event->type = TSDL_EVENT_QUIT;
         active_window->close_requested = TSDL_FALSE;
 
-        LOG_STAT("Quit event set: type=%d", event->type);
+        LOG_TRACE("Quit event set: type=%d", event->type);
         // Log exact type
 
-        return TSDL_TRUE;
+        if (dispatch_event(event))
+            return TSDL_TRUE;
     }
 
-    return TSDL_FALSE;
+    return poll_posted_event(event);
+}
+int tsdl_waitEvent(Event event, int timeout)
+{
+    if (!is_initialized || !event)
+        return TSDL_FALSE;
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long long deadline = now.tv_sec * 1000LL + now.tv_nsec / 1000000 + timeout;
+    while (!tsdl_pollEvent(event))
+    {
+        if (XPending(global_display))
+            continue; // already read off the socket; poll() would miss it
+
+        int wait = -1;
+        if (timeout >= 0)
+        {
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            long long remaining = deadline - (now.tv_sec * 1000LL + now.tv_nsec / 1000000);
+            if (remaining <= 0)
+                return TSDL_FALSE;
+            wait = (int)remaining;
+        }
+
+        struct pollfd fds[2] = {
+            {.fd = ConnectionNumber(global_display), .events = POLLIN},
+            {.fd = wake_pipe[0], .events = POLLIN},
+        };
+        XFlush(global_display);
+        if (poll(fds, 2, wait) > 0 && (fds[1].revents & POLLIN))
+        {
+            char drain[64];
+            while (read(wake_pipe[0], drain, sizeof(drain)) > 0)
+                ;
+        }
+    }
+
+    return TSDL_TRUE;
+}
+void tsdl_wakeEvents(void)
+{
+    if (wake_pipe[1] >= 0)
+    {
+        // a full pipe (EAGAIN) already means a wake-up is pending
+        ssize_t n = write(wake_pipe[1], "", 1);
+        (void)n;
+    }
+}
+void tsdl_updateEventMask(void)
+{
+    if (!active_window)
+        return;
+    XSelectInput(active_window->display, active_window->xwindow, event_mask());
+    XFlush(active_window->display);
 }
 const string tsdl_getVersion(void)
 {
@@ -393,16 +621,19 @@ window window_create(string title, int x, int y, int w, int h, int flags)
     }
 
     //  set initial window properties
-    win->w = w;
-    win->h = h;
-    win->x = x;
-    win->y = y;
-    win->is_fullscreen = (flags & TSDL_WINDOW_FULLSCREEN) ? TSDL_TRUE : TSDL_FALSE;
-    win->resto.w = w;
-    win->resto.h = h;
-    win->resto.x = x;
-    win->resto.y = y;
+    // shown once the MapNotify arrives
+    track_init(&win->track, x, y, w, h, flags & ~TSDL_WINDOW_SHOWN);
     win->close_requested = TSDL_FALSE;
+    win->relative = TSDL_FALSE;
+    win->rel_dx = win->rel_dy = 0;
+    win->xic = NULL;
+    if (input_method)
+    {
+        win->xic = XCreateIC(input_method, XNInputStyle, XIMPreeditNothing | XIMStatusNothing,
+                             XNClientWindow, win->xwindow, XNFocusWindow, win->xwindow, NULL);
+        if (win->xic && XGetICValues(win->xic, XNFilterEvents, &im_events, NULL) != NULL)
+            im_events = 0;
+    }
 
     //  set the window title
     XStoreName(win->display, win->xwindow, title);
@@ -415,18 +646,12 @@ window window_create(string title, int x, int y, int w, int h, int flags)
         return NULL;
     }
 
-    XSelectInput(win->display, win->xwindow, StructureNotifyMask | ExposureMask | KeyPressMask | KeyReleaseMask | FocusChangeMask | ButtonPressMask | ButtonReleaseMask | PointerMotionMask);
+    XSelectInput(win->display, win->xwindow, event_mask());
+    //  accept XDND drops (protocol version 5)
+    Atom xdnd_version = 5;
+    XChangeProperty(win->display, win->xwindow, xdnd.aware, XA_ATOM, 32, PropModeReplace, (unsigned char *)&xdnd_version, 1);
 
-    int attribs[] = {GLX_RGBA, GLX_DOUBLEBUFFER, GLX_DEPTH_SIZE, 24, None};
-    XVisualInfo *vi = glXChooseVisual(win->display, DefaultScreen(win->display), attribs);
-    if (!vi)
-    {
-        XDestroyWindow(win->display, win->xwindow);
-        Mem.free(win);
-        log_error(TSDL_ERR_GL, "Failed to choose GLX visual");
-        return NULL;
-    }
-    win->glx_context = glXCreateContext(win->display, vi, NULL, GL_TRUE);
+    win->glx_context = create_context(win->display, win->xwindow);
     if (!win->glx_context)
     {
         XDestroyWindow(win->display, win->xwindow);
@@ -434,9 +659,14 @@ window window_create(string title, int x, int y, int w, int h, int flags)
         log_error(TSDL_ERR_GL, "Failed to create GLX context");
         return NULL;
     }
-    glXMakeCurrent(win->display, win->xwindow, win->glx_context);
+    make_current(win);
     active_window = win;
 
+    //  fullscreen never changes the video mode here; exclusive asks the compositor to unredirect
+    //  the window, borderless asks it not to, so toggling doesn't flash a black frame
+    long bypass = (flags & TSDL_WINDOW_EXCLUSIVE) ? 1 : 2;
+    XChangeProperty(win->display, win->xwindow, wm.bypass, XA_CARDINAL, 32, PropModeReplace, (unsigned char *)&bypass, 1);
+
     //  set window flags
     if (flags & TSDL_WINDOW_SHOWN)
     {
@@ -444,44 +674,37 @@ window window_create(string title, int x, int y, int w, int h, int flags)
     }
     if (flags & TSDL_WINDOW_FULLSCREEN)
     {
-        Atom wm_state = XInternAtom(win->display, "_NET_WM_STATE", TSDL_FALSE);
-        Atom fullscreen = XInternAtom(win->display, "_NET_WM_STATE_FULLSCREEN", TSDL_FALSE);
         XEvent xev = {0};
         xev.type = ClientMessage;
         xev.xclient.window = win->xwindow;
-        xev.xclient.message_type = wm_state;
+        xev.xclient.message_type = wm.net_state;
         xev.xclient.format = 32;
         xev.xclient.data.l[0] = 1;
-        xev.xclient.data.l[1] = fullscreen;
+        xev.xclient.data.l[1] = wm.fullscreen;
         XSendEvent(win->display, DefaultRootWindow(win->display), TSDL_FALSE, SubstructureRedirectMask | SubstructureNotifyMask, &xev);
     }
     else if (flags & TSDL_WINDOW_MAXIMIZED)
     {
-        Atom wm_state = XInternAtom(win->display, "_NET_WM_STATE", TSDL_FALSE);
-        Atom max_horz = XInternAtom(win->display, "_NET_WM_STATE_MAXIMIZED_HORZ", TSDL_FALSE);
-        Atom max_vert = XInternAtom(win->display, "_NET_WM_STATE_MAXIMIZED_VERT", TSDL_FALSE);
         XEvent xev = {0};
         xev.type = ClientMessage;
         xev.xclient.window = win->xwindow;
-        xev.xclient.message_type = wm_state;
+        xev.xclient.message_type = wm.net_state;
         xev.xclient.format = 32;
         xev.xclient.data.l[0] = 1; // _NET_WM_STATE_ADD
-        xev.xclient.data.l[1] = max_horz;
-        xev.xclient.data.l[2] = max_vert;
+        xev.xclient.data.l[1] = wm.max_horz;
+        xev.xclient.data.l[2] = wm.max_vert;
         XSendEvent(win->display, DefaultRootWindow(win->display), TSDL_FALSE, SubstructureRedirectMask | SubstructureNotifyMask, &xev);
     }
     else if (flags & TSDL_WINDOW_CENTERED)
     {
-        int screen = DefaultScreen(win->display);
-        int screen_width = DisplayWidth(win->display, screen);
-        int screen_height = DisplayHeight(win->display, screen);
-        x = (screen_width - w) / 2;
-        y = (screen_height - h) / 2;
+        // centred on the monitor under the requested position
+        TSDL_DisplayInfo display = {0};
+        display_state(display_at(x, y), &display);
+        x = display.x + (display.w - w) / 2;
+        y = display.y + (display.h - h) / 2;
         XMoveWindow(win->display, win->xwindow, x, y);
-        win->x = x;
-        win->y = y;
-        win->resto.x = x;
-        win->resto.y = y;
+        win->track.x = win->track.normal.x = x;
+        win->track.y = win->track.normal.y = y;
     }
     else
     {
@@ -519,12 +742,17 @@ void window_destroy(window win)
     }
     if (win->xwindow && win->display)
     {
+        tsdl_stopRenderThread(win);
+        tsdl_endCapture(win);
         glXMakeCurrent(win->display, None, NULL);
+        glstate_invalidate();
         if (win->glx_context)
         {
             glXDestroyContext(win->display, win->glx_context);
             win->glx_context = NULL;
         }
+        if (win->xic)
+            XDestroyIC(win->xic);
         XDestroyWindow(win->display, win->xwindow);
         XFlush(win->display);
     }
@@ -534,22 +762,25 @@ void window_destroy(window win)
     Mem.free(win);
 
     //  [TODO] TASK: logging
-    LOG_STAT("Window destroyed\n");
+    LOG_STAT("Window destroyed");
 }
 void window_toggleFullscreen(window win)
 {
-    Atom wm_state = XInternAtom(win->display, "_NET_WM_STATE", False);
-    Atom fullscreen = XInternAtom(win->display, "_NET_WM_STATE_FULLSCREEN", False);
+    // switch the tracker now, so the configure that follows doesn't become the restore geometry
+    TSDL_Event transition = {0};
+    win->track.fullscreen = !win->track.fullscreen;
+    if (track_state(&win->track, &transition))
+        post_event(&transition);
 
     XEvent event;
     memset(&event, 0, sizeof(event));
 
     event.type = ClientMessage;
     event.xclient.window = win->xwindow;
-    event.xclient.message_type = wm_state;
+    event.xclient.message_type = wm.net_state;
     event.xclient.format = 32;
-    event.xclient.data.l[0] = 2; // _NET_WM_STATE_TOGGLE
-    event.xclient.data.l[1] = fullscreen;
+    event.xclient.data.l[0] = win->track.fullscreen; // _NET_WM_STATE_ADD / _REMOVE, so the WM can't drift from the tracker
+    event.xclient.data.l[1] = wm.fullscreen;
     event.xclient.data.l[2] = 0; // No second property
 
     XSendEvent(win->display, DefaultRootWindow(win->display), False,
@@ -567,32 +798,811 @@ object window_getGLContext(window win)
         log_error(TSDL_ERR_WINDOW, "Attempt to obtain GL context from invalid (NULL) window handle");
         return NULL;
     }
-    glXMakeCurrent(win->display, win->xwindow, win->glx_context);
+    if (!render_thread_owns(win))
+        make_current(win);
     return (object)win->glx_context;
 }
+int window_setRelativeMouse(window win, int enabled)
+{
+    if (!win || !win->xwindow)
+        return log_error(TSDL_ERR_WINDOW, "Attempt to set relative mouse on invalid (NULL) window handle");
+
+    unsigned char bits[XIMaskLen(XI_RawMotion)] = {0};
+    XIEventMask mask = {.deviceid = XIAllMasterDevices, .mask_len = sizeof(bits), .mask = bits};
+    if (enabled)
+    {
+        if (invisible_cursor == None)
+        {
+            char empty = 0;
+            XColor black = {0};
+            Pixmap pixmap = XCreateBitmapFromData(win->display, win->xwindow, &empty, 1, 1);
+            invisible_cursor = XCreatePixmapCursor(win->display, pixmap, pixmap, &black, &black, 0, 0);
+            XFreePixmap(win->display, pixmap);
+        }
+        // confine and hide the pointer; raw deltas keep coming at the window edge
+        unsigned int grab_mask = event_mask() & (ButtonPressMask | ButtonReleaseMask | PointerMotionMask);
+        if (XGrabPointer(win->display, win->xwindow, True, grab_mask, GrabModeAsync, GrabModeAsync,
+                         win->xwindow, invisible_cursor, CurrentTime) != GrabSuccess)
+            return log_error(TSDL_ERR_WINDOW, "Failed to grab pointer");
+        if (xi_opcode < 0)
+            XWarpPointer(win->display, None, win->xwindow, 0, 0, 0, 0, win->track.w / 2, win->track.h / 2);
+        XISetMask(bits, XI_RawMotion);
+    }
+    else
+    {
+        XUngrabPointer(win->display, CurrentTime);
+    }
+    if (xi_opcode >= 0)
+        XISelectEvents(win->display, DefaultRootWindow(win->display), &mask, 1);
+    XFlush(win->display);
+
+    win->relative = enabled ? TSDL_TRUE : TSDL_FALSE;
+    win->rel_dx = win->rel_dy = 0;
+
+    LOG_STAT("Relative mouse=%d (XInput2=%d)", win->relative, xi_opcode >= 0);
+
+    return TSDL_ERR_NONE;
+}
+int window_isVisible(window win)
+{
+    if (!win || !win->xwindow)
+        return TSDL_FALSE;
+    return track_visible(&win->track);
+}
+int window_getDisplay(window win)
+{
+    if (!win || !win->xwindow)
+        return -1;
+    return display_at(win->track.x + win->track.w / 2, win->track.y + win->track.h / 2);
+}
+
+// XDND Helpers ===============================================================
+static int uri_reserve(uri_parser *p, size_t extra)
+{
+    if (p->len + extra <= p->cap)
+        return TSDL_TRUE;
+
+    size_t cap = p->cap ? p->cap * 2 : 4096;
+    while (cap < p->len + extra)
+        cap *= 2;
+    char *buf = Mem.alloc(cap);
+    if (!buf)
+        return TSDL_FALSE;
+    if (p->buf)
+    {
+        memcpy(buf, p->buf, p->len);
+        Mem.free(p->buf);
+    }
+    p->buf = buf;
+    p->cap = cap;
+
+    return TSDL_TRUE;
+}
+static void uri_reset(uri_parser *p)
+{
+    if (p->buf)
+        Mem.free(p->buf);
+    memset(p, 0, sizeof(uri_parser));
+    p->pct = -1;
+}
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+/* Finish the current line: drop the file://host prefix and terminate it as a path */
+static void uri_end_line(uri_parser *p)
+{
+    if (p->pct >= 0 && uri_reserve(p, 2))
+    {
+        // unterminated escape: keep it literally
+        p->buf[p->len++] = '%';
+        if (p->pct == 1)
+            p->buf[p->len++] = "0123456789ABCDEF"[p->hi];
+    }
+    p->pct = -1;
+
+    char *line = p->buf + p->line;
+    size_t len = p->len - p->line;
+    if (p->skip || len == 0)
+    {
+        p->len = p->line;
+        p->skip = TSDL_FALSE;
+        return;
+    }
+    if (len > 7 && memcmp(line, "file://", 7) == 0)
+    {
+        char *path = memchr(line + 7, '/', len - 7);
+        size_t skip = path ? (size_t)(path - line) : len;
+        memmove(line, line + skip, len - skip);
+        len -= skip;
+    }
+    p->len = p->line + len;
+    if (len == 0 || !uri_reserve(p, 1))
+        return;
+
+    p->buf[p->len++] = '\0';
+    p->line = p->len;
+    p->count++;
+}
+/* Decode a chunk of text/uri-list; escapes and lines may straddle chunk boundaries */
+static void uri_feed(uri_parser *p, const char *data, size_t n)
+{
+    // decoding never grows the text, so one reservation covers the chunk
+    if (!uri_reserve(p, n + 2))
+        return;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        char c = data[i];
+        if (c == '\r')
+            continue;
+        if (c == '\n')
+        {
+            uri_end_line(p);
+            continue;
+        }
+        if (p->skip)
+            continue;
+        if (p->len == p->line && p->pct < 0 && c == '#')
+        {
+            p->skip = TSDL_TRUE;
+            continue;
+        }
+
+        if (p->pct < 0)
+        {
+            if (c == '%')
+                p->pct = 0;
+            else
+                p->buf[p->len++] = c;
+            continue;
+        }
+
+        int digit = hex_value(c);
+        if (digit < 0)
+        {
+            // malformed escape: keep it literally
+            p->buf[p->len++] = '%';
+            if (p->pct == 1)
+                p->buf[p->len++] = "0123456789ABCDEF"[p->hi];
+            p->buf[p->len++] = c;
+            p->pct = -1;
+        }
+        else if (p->pct == 0)
+        {
+            p->hi = digit;
+            p->pct = 1;
+        }
+        else
+        {
+            // %00 would end the path early and throw off the packed offsets
+            if ((p->hi << 4 | digit) == 0)
+                p->skip = TSDL_TRUE;
+            else
+                p->buf[p->len++] = (char)(p->hi << 4 | digit);
+            p->pct = -1;
+        }
+    }
+}
+static void xdnd_send(window win, Atom type, long l1, long l4)
+{
+    XEvent reply = {0};
+    reply.xclient.type = ClientMessage;
+    reply.xclient.display = win->display;
+    reply.xclient.window = xdnd.source;
+    reply.xclient.message_type = type;
+    reply.xclient.format = 32;
+    reply.xclient.data.l[0] = win->xwindow;
+    reply.xclient.data.l[1] = l1;
+    reply.xclient.data.l[2] = type == xdnd.finished ? l4 : 0;
+    reply.xclient.data.l[4] = type == xdnd.status ? l4 : 0;
+    XSendEvent(win->display, xdnd.source, TSDL_FALSE, NoEventMask, &reply);
+    XFlush(win->display);
+}
+static void xdnd_finish(window win, int accepted)
+{
+    if (xdnd.source != None && xdnd.version >= 2)
+        xdnd_send(win, xdnd.finished, accepted ? 1 : 0, accepted ? (long)xdnd.action_copy : None);
+    xdnd.source = None;
+    xdnd.accept = TSDL_FALSE;
+    xdnd.incr_active = TSDL_FALSE;
+    uri_reset(&xdnd.parser);
+}
+/* Hand the decoded paths to the event and acknowledge the drop */
+static int xdnd_complete(window win, Event event)
+{
+    uri_end_line(&xdnd.parser); // the last line needn't be terminated
+    uri_parser *p = &xdnd.parser;
+    int delivered = TSDL_FALSE;
+    if (p->count > 0)
+    {
+        event->data.drop.paths = pack_drop_paths(p->count, p->buf, p->line);
+        event->data.drop.count = p->count;
+        if (event->data.drop.paths)
+        {
+            event->type = TSDL_EVENT_DROP;
+            delivered = TSDL_TRUE;
+        }
+    }
+    LOG_STAT("XDND drop complete: %d paths", p->count);
+    xdnd_finish(win, delivered);
+
+    return delivered;
+}
+/* Read (and delete) the transfer property, feeding it to the parser in chunks */
+static int xdnd_read_property(window win, Atom *type)
+{
+    long offset = 0;
+    unsigned long remaining = 0;
+    size_t total = 0;
+    do
+    {
+        Atom actual;
+        int format;
+        unsigned long items;
+        unsigned char *data = NULL;
+        if (XGetWindowProperty(win->display, win->xwindow, xdnd.property, offset, 16384, TSDL_FALSE,
+                               AnyPropertyType, &actual, &format, &items, &remaining, &data) != Success)
+            return -1;
+        *type = actual;
+        if (actual != xdnd.incr && data && items)
+        {
+            size_t bytes = items * (format / 8);
+            uri_feed(&xdnd.parser, (const char *)data, bytes);
+            total += bytes;
+            offset += bytes / 4;
+        }
+        if (data)
+            XFree(data);
+        if (actual == xdnd.incr)
+            break;
+    } while (remaining > 0);
+    XDeleteProperty(win->display, win->xwindow, xdnd.property);
+
+    return (int)(total > 0);
+}
+static int xdnd_client_message(window win, XClientMessageEvent *msg)
+{
+    if (msg->message_type == xdnd.enter)
+    {
+        xdnd_finish(win, TSDL_FALSE); // a new drag replaces any stale one
+        xdnd.source = msg->data.l[0];
+        xdnd.version = (int)(msg->data.l[1] >> 24);
+        if (msg->data.l[1] & 1)
+        {
+            // more than three types: the full list is on the source window
+            Atom actual, *types = NULL;
+            int format;
+            unsigned long count = 0, remaining;
+            if (XGetWindowProperty(win->display, xdnd.source, xdnd.type_list, 0, 64, TSDL_FALSE, XA_ATOM,
+                                   &actual, &format, &count, &remaining, (unsigned char **)&types) == Success)
+            {
+                for (unsigned long i = 0; i < count; i++)
+                    xdnd.accept |= types[i] == xdnd.uri_list;
+            }
+            if (types)
+                XFree(types);
+        }
+        else
+        {
+            for (int i = 2; i < 5; i++)
+                xdnd.accept |= (Atom)msg->data.l[i] == xdnd.uri_list;
+        }
+        LOG_STAT("XDND enter: version=%d accept=%d", xdnd.version, xdnd.accept);
+    }
+    else if (msg->message_type == xdnd.position)
+    {
+        // accept, and keep sending positions (bit 1) so the source's feedback stays current
+        xdnd_send(win, xdnd.status, xdnd.accept ? 3 : 2, xdnd.accept ? (long)xdnd.action_copy : None);
+    }
+    else if (msg->message_type == xdnd.leave)
+    {
+        xdnd.source = None;
+        xdnd.accept = TSDL_FALSE;
+    }
+    else if (msg->message_type == xdnd.drop)
+    {
+        if (!xdnd.accept || !event_enabled(TSDL_EVENT_DROP))
+        {
+            xdnd_finish(win, TSDL_FALSE);
+            return TSDL_TRUE;
+        }
+        // the data arrives as SelectionNotify (and PropertyNotify chunks for INCR)
+        Time time = xdnd.version >= 1 ? (Time)msg->data.l[2] : CurrentTime;
+        uri_reset(&xdnd.parser);
+        XConvertSelection(win->display, xdnd.selection, xdnd.uri_list, xdnd.property, win->xwindow, time);
+        XFlush(win->display);
+    }
+    else
+    {
+        return TSDL_FALSE;
+    }
+
+    return TSDL_TRUE;
+}
+static int xdnd_selection_notify(window win, XSelectionEvent *sel, Event event)
+{
+    if (sel->selection != xdnd.selection || xdnd.source == None)
+        return TSDL_FALSE;
+    if (sel->property == None)
+    {
+        xdnd_finish(win, TSDL_FALSE);
+        return TSDL_FALSE;
+    }
+
+    Atom type = None;
+    if (xdnd_read_property(win, &type) < 0)
+    {
+        xdnd_finish(win, TSDL_FALSE);
+        return TSDL_FALSE;
+    }
+    if (type == xdnd.incr)
+    {
+        // deleting the INCR property asked for the first chunk; chunks arrive as PropertyNotify
+        xdnd.incr_active = TSDL_TRUE;
+        LOG_STAT("XDND INCR transfer started");
+        return TSDL_FALSE;
+    }
+
+    return xdnd_complete(win, event);
+}
+static int xdnd_property_notify(window win, XPropertyEvent *prop, Event event)
+{
+    if (!xdnd.incr_active || prop->atom != xdnd.property || prop->state != PropertyNewValue)
+        return TSDL_FALSE;
+
+    Atom type = None;
+    int got = xdnd_read_property(win, &type);
+    if (got < 0)
+    {
+        xdnd_finish(win, TSDL_FALSE);
+        return TSDL_FALSE;
+    }
+    // a zero-length chunk ends the transfer
+    return got ? TSDL_FALSE : xdnd_complete(win, event);
+}
 
 // Specialized Helper Functions ===============================================
-int map_key_mods(int x11_mods)
+/* X input mask for the enabled event types; the server never sends the rest */
+static long event_mask(void)
 {
-    int mods = mod_state; // Start with tracked state
-    if (!(x11_mods & ShiftMask))
+    long mask = StructureNotifyMask | FocusChangeMask | PropertyChangeMask | VisibilityChangeMask; // always: geometry, held modifiers, window state, occlusion
+    if (event_enabled(TSDL_EVENT_WINDOW_EXPOSED))
+        mask |= ExposureMask;
+    if (event_enabled(TSDL_EVENT_KEY_DOWN))
+        mask |= KeyPressMask;
+    if (event_enabled(TSDL_EVENT_KEY_UP))
+        mask |= KeyReleaseMask;
+    if (event_enabled(TSDL_EVENT_TEXT_INPUT))
+        mask |= KeyPressMask | im_events;
+    if (event_enabled(TSDL_EVENT_MOUSE_BUTTON_DOWN) || event_enabled(TSDL_EVENT_MOUSE_WHEEL))
+        mask |= ButtonPressMask; // wheel arrives as buttons 4/5
+    if (event_enabled(TSDL_EVENT_MOUSE_BUTTON_UP))
+        mask |= ButtonReleaseMask;
+    if (event_enabled(TSDL_EVENT_MOUSE_MOVED) || (xi_opcode < 0 && event_enabled(TSDL_EVENT_MOUSE_RELATIVE)))
+        mask |= PointerMotionMask; // without XInput2 relative motion is derived from core motion
+
+    return mask;
+}
+/* Add an XI_RawMotion event's unaccelerated deltas to the window's relative motion */
+static void accumulate_raw_motion(window win, XEvent *xev)
+{
+    XGenericEventCookie *cookie = &xev->xcookie;
+    if (cookie->extension != xi_opcode || !XGetEventData(global_display, cookie))
+        return;
+
+    XIRawEvent *raw = cookie->data;
+    if (cookie->evtype == XI_RawMotion && win && win->relative)
     {
-        mods &= ~(TSDL_MOD_LSHIFT | TSDL_MOD_RSHIFT); // Clear if mask off
+        // raw_values holds only the valuators set in the mask, in axis order
+        const double *value = raw->raw_values;
+        for (int axis = 0; axis < 2 && axis < raw->valuators.mask_len * 8; axis++)
+        {
+            if (!XIMaskIsSet(raw->valuators.mask, axis))
+                continue;
+            if (axis == 0)
+                win->rel_dx += *value;
+            else
+                win->rel_dy += *value;
+            value++;
+        }
     }
-    if (!(x11_mods & ControlMask))
+    XFreeEventData(global_display, cookie);
+}
+/* Without an input method: Latin-1 keysyms are their code point, 0x01xxxxxx keysyms carry one */
+static unsigned int keysym_to_ucs(KeySym keysym)
+{
+    if ((keysym >= 0x20 && keysym <= 0x7E) || (keysym >= 0xA0 && keysym <= 0xFF))
+        return (unsigned int)keysym;
+    if ((keysym & 0xFF000000) == 0x01000000)
+        return (unsigned int)(keysym & 0x00FFFFFF);
+
+    return 0;
+}
+/* Stage the characters a key press produces (composed or committed by the IME) */
+static void lookup_text(window win, XKeyEvent *key)
+{
+    char *dst = text.buf + text.len;
+    int room = TEXT_STAGING - text.len;
+    KeySym keysym;
+    int len;
+    if (win->xic)
     {
-        mods &= ~(TSDL_MOD_LCTRL | TSDL_MOD_RCTRL);
+        Status status;
+        len = Xutf8LookupString(win->xic, key, dst, room, &keysym, &status);
+        if (status == XBufferOverflow)
+        {
+            LOG_WARN("Dropped %d bytes of input method text", len);
+            return;
+        }
+        if (status != XLookupChars && status != XLookupBoth)
+            return;
     }
-    if (!(x11_mods & Mod1Mask))
+    else
     {
-        mods &= ~(TSDL_MOD_LALT | TSDL_MOD_RALT);
+        char latin1[8];
+        XLookupString(key, latin1, sizeof(latin1), &keysym, NULL);
+        unsigned int ucs = keysym_to_ucs(keysym);
+        len = ucs ? utf8_encode(ucs, dst) : 0;
     }
-    if (!(x11_mods & Mod4Mask))
+
+    // Return, BackSpace, Ctrl+letter etc. are keys, not text
+    if (len == 1 && ((unsigned char)dst[0] < 0x20 || dst[0] == 0x7F))
+        return;
+    text.len += len;
+}
+/* Deliver staged text once the key burst ends, in inline-sized events */
+static int poll_text(Event event)
+{
+    while (text.len > 0)
     {
-        mods &= ~(TSDL_MOD_LSUPER | TSDL_MOD_RSUPER);
+        if (XPending(global_display) && text.len <= TEXT_STAGING - TEXT_LOOKUP)
+        {
+            XEvent next;
+            XPeekEvent(global_display, &next);
+            if (next.type == KeyPress || next.type == KeyRelease)
+                return TSDL_FALSE; // still typing; keep batching
+        }
+
+        event->type = TSDL_EVENT_NONE;
+        int taken = append_text(event, text.buf, text.len);
+        memmove(text.buf, text.buf + taken, text.len - taken);
+        text.len -= taken;
+        if (dispatch_event(event))
+            return TSDL_TRUE;
+    }
+
+    return TSDL_FALSE;
+}
+/* Update the tracker from a changed WM_STATE or _NET_WM_STATE; TSDL_FALSE for any other property */
+static int read_wm_state(window win, Atom property)
+{
+    if (property != wm.wm_state && property != wm.net_state)
+        return TSDL_FALSE;
+
+    Atom type;
+    int format;
+    unsigned long count, after;
+    unsigned char *data = NULL;
+    Atom req_type = property == wm.wm_state ? wm.wm_state : XA_ATOM;
+    if (XGetWindowProperty(win->display, win->xwindow, property, 0, 64, False, req_type,
+                           &type, &format, &count, &after, &data) != Success)
+        return TSDL_TRUE;
+
+    if (property == wm.wm_state)
+    {
+        // first field is the ICCCM state: 1 = Normal, 3 = Iconic
+        win->track.minimized = data && count > 0 && ((long *)data)[0] == IconicState;
+    }
+    else
+    {
+        int horz = TSDL_FALSE, vert = TSDL_FALSE, full = TSDL_FALSE;
+        for (unsigned long i = 0; data && i < count; i++)
+        {
+            Atom state = ((Atom *)data)[i];
+            horz |= state == wm.max_horz;
+            vert |= state == wm.max_vert;
+            full |= state == wm.fullscreen;
+        }
+        win->track.maximized = horz && vert;
+        win->track.fullscreen = full;
+    }
+    if (data)
+        XFree(data);
+
+    return TSDL_TRUE;
+}
+/* TSDL_MOD_* bit held by a modifier keysym, 0 for anything else */
+static int modifier_bit(KeySym sym)
+{
+    switch (sym)
+    {
+    case XK_Shift_L:
+        return TSDL_MOD_LSHIFT;
+    case XK_Shift_R:
+        return TSDL_MOD_RSHIFT;
+    case XK_Control_L:
+        return TSDL_MOD_LCTRL;
+    case XK_Control_R:
+        return TSDL_MOD_RCTRL;
+    case XK_Alt_L:
+        return TSDL_MOD_LALT;
+    case XK_Alt_R:
+        return TSDL_MOD_RALT;
+    case XK_Super_L:
+        return TSDL_MOD_LSUPER;
+    case XK_Super_R:
+        return TSDL_MOD_RSUPER;
+    default:
+        return 0;
+    }
+}
+/* Fill one keycode's entries from its symbols, level 0 first */
+static void set_key(unsigned int keycode, const KeySym *syms, int levels)
+{
+    if (keycode > 0xFF || levels <= 0)
+        return;
+
+    // keys name their unshifted symbol; keypad keys their NumLock level (KP_7, not KP_Home)
+    KeySym sym = (levels > 1 && IsKeypadKey(syms[1])) ? syms[1] : syms[0];
+    keymap.keys[keycode] = sym == NoSymbol ? 0 : map_keys(sym);
+    keymap.mods[keycode] = (unsigned char)modifier_bit(syms[0]);
+}
+/* Precompute keycode -> TSDL key and modifier bit for the active layout */
+static void build_keymap(void)
+{
+    memset(keymap.keys, 0, sizeof(keymap.keys));
+    memset(keymap.mods, 0, sizeof(keymap.mods));
+
+    XkbDescPtr desc = NULL;
+    if (keymap.xkb_event >= 0)
+    {
+        XkbStateRec state;
+        keymap.group = XkbGetState(global_display, XkbUseCoreKbd, &state) == Success ? state.group : 0;
+        desc = XkbGetMap(global_display, XkbKeyTypesMask | XkbKeySymsMask, XkbUseCoreKbd);
+    }
+    if (desc)
+    {
+        for (int keycode = desc->min_key_code; keycode <= desc->max_key_code; keycode++)
+        {
+            int groups = XkbKeyNumGroups(desc, keycode);
+            if (!groups)
+                continue;
+            int group = keymap.group % groups; // out-of-range groups wrap, as XKB does by default
+            int levels = XkbKeyGroupWidth(desc, keycode, group);
+            KeySym syms[2] = {NoSymbol, NoSymbol};
+            for (int level = 0; level < levels && level < 2; level++)
+                syms[level] = XkbKeySymEntry(desc, keycode, level, group);
+            set_key(keycode, syms, levels < 2 ? levels : 2);
+        }
+        XkbFreeKeyboard(desc, 0, True);
+        return;
+    }
+
+    // core protocol mapping: group 1 only
+    int min, max, per;
+    XDisplayKeycodes(global_display, &min, &max);
+    KeySym *syms = XGetKeyboardMapping(global_display, min, max - min + 1, &per);
+    if (!syms)
+        return;
+    for (int keycode = min; keycode <= max; keycode++)
+        set_key(keycode, syms + (keycode - min) * per, per < 2 ? per : 2);
+    XFree(syms);
+}
+/* Modifiers held right now, from the server's key bitmap */
+static int held_mods(void)
+{
+    char keys[32];
+    XQueryKeymap(global_display, keys);
+    int mods = TSDL_MOD_NONE;
+    for (int keycode = 0; keycode < 256; keycode++)
+    {
+        if (keys[keycode >> 3] & (1 << (keycode & 7)))
+            mods |= keymap.mods[keycode];
     }
+
     return mods;
 }
+/* Drop the sides of any modifier that is off in an X modifier mask */
+static int mask_mods(int mods, unsigned int x11_mods)
+{
+    if (!(x11_mods & ShiftMask))
+        mods &= ~(TSDL_MOD_LSHIFT | TSDL_MOD_RSHIFT);
+    if (!(x11_mods & ControlMask))
+        mods &= ~(TSDL_MOD_LCTRL | TSDL_MOD_RCTRL);
+    if (!(x11_mods & Mod1Mask))
+        mods &= ~(TSDL_MOD_LALT | TSDL_MOD_RALT);
+    if (!(x11_mods & Mod4Mask))
+        mods &= ~(TSDL_MOD_LSUPER | TSDL_MOD_RSUPER);
+
+    return mods;
+}
+/* Refresh rate of an XRandR mode in Hz (0 = unknown) */
+static double mode_refresh(const XRRScreenResources *res, RRMode id)
+{
+    for (int i = 0; i < res->nmode; i++)
+    {
+        const XRRModeInfo *mode = &res->modes[i];
+        if (mode->id != id || !mode->hTotal || !mode->vTotal)
+            continue;
+        double lines = mode->vTotal;
+        if (mode->modeFlags & RR_DoubleScan)
+            lines *= 2;
+        if (mode->modeFlags & RR_Interlace)
+            lines /= 2;
+        return (double)mode->dotClock / (mode->hTotal * lines);
+    }
+
+    return 0;
+}
+/* Xft.dpi over 96; X has no per-monitor scale, so desktops apply this one everywhere */
+static float desktop_scale(void)
+{
+    const char *resources = XResourceManagerString(global_display);
+    const char *dpi = resources ? strstr(resources, "Xft.dpi:") : NULL;
+    float value = dpi ? strtof(dpi + strlen("Xft.dpi:"), NULL) : 0;
+
+    return value > 0 ? value / 96.0f : 1.0f;
+}
+/* Hand the lit XRandR outputs (or, without RandR, the default screen) to the display subsystem */
+static void refresh_displays(void)
+{
+    TSDL_DisplayInfo list[TSDL_MAX_DISPLAYS] = {0};
+    int count = 0;
+    float scale = desktop_scale();
+    Window root = DefaultRootWindow(global_display);
+    XRRScreenResources *res = randr_event >= 0 ? XRRGetScreenResourcesCurrent(global_display, root) : NULL;
+    if (res)
+    {
+        RROutput primary = XRRGetOutputPrimary(global_display, root);
+        for (int i = 0; i < res->noutput && count < TSDL_MAX_DISPLAYS; i++)
+        {
+            XRROutputInfo *output = XRRGetOutputInfo(global_display, res, res->outputs[i]);
+            XRRCrtcInfo *crtc = NULL;
+            if (output && output->connection == RR_Connected && output->crtc != None)
+                crtc = XRRGetCrtcInfo(global_display, res, output->crtc);
+            if (crtc && crtc->mode != None)
+            {
+                // crtc geometry is already rotated
+                TSDL_DisplayInfo *display = &list[count++];
+                display->x = crtc->x;
+                display->y = crtc->y;
+                display->w = (int)crtc->width;
+                display->h = (int)crtc->height;
+                display->refresh = mode_refresh(res, crtc->mode);
+                display->scale = scale;
+                display->primary = res->outputs[i] == primary;
+                snprintf(display->name, sizeof(display->name), "%s", output->name);
+            }
+            if (crtc)
+                XRRFreeCrtcInfo(crtc);
+            if (output)
+                XRRFreeOutputInfo(output);
+        }
+        XRRFreeScreenResources(res);
+    }
+    if (count == 0)
+    {
+        int screen = DefaultScreen(global_display);
+        TSDL_DisplayInfo *display = &list[count++];
+        display->primary = TSDL_TRUE;
+        display->w = DisplayWidth(global_display, screen);
+        display->h = DisplayHeight(global_display, screen);
+        display->scale = scale;
+        snprintf(display->name, sizeof(display->name), "screen-%d", screen);
+    }
+
+    display_update(list, count);
+}
+/* The keyboard mapping or active layout changed; rebuild the tables */
+static void keymap_notify(XEvent *xev)
+{
+    if (xev->type == MappingNotify)
+    {
+        if (xev->xmapping.request == MappingPointer)
+            return;
+        XRefreshKeyboardMapping(&xev->xmapping);
+    }
+    else
+    {
+        XkbEvent *xkb = (XkbEvent *)xev;
+        if (xkb->any.xkb_type == XkbStateNotify)
+        {
+            // delivered whatever has focus, so releases we never saw still clear
+            mod_state = mask_mods(mod_state, xkb->state.mods);
+            if (xkb->state.group == keymap.group)
+                return; // modifier-only state change
+        }
+    }
+    build_keymap();
+
+    LOG_STAT("Keymap rebuilt for group %d", keymap.group);
+}
+/* Make the window's context current; the GL state cache is only dropped on an actual switch */
+static void make_current(window win)
+{
+    if (glXGetCurrentContext() == win->glx_context && glXGetCurrentDrawable() == win->xwindow)
+        return;
+    glXMakeCurrent(win->display, win->xwindow, win->glx_context);
+    glstate_invalidate();
+}
+/* A refused context version is reported as an X error; note it rather than exiting */
+static int context_error_handler(Display *display, XErrorEvent *error)
+{
+    context_refused = TSDL_TRUE;
+    return 0;
+}
+/* OpenGL 3.3 core context, as GLFW asks for; a legacy context only when the driver can't make one.
+   Either way it is made for the window's own visual, or glXMakeCurrent fails with BadMatch */
+static GLXContext create_context(Display *display, Window xwindow)
+{
+    int screen = DefaultScreen(display);
+    XWindowAttributes attributes;
+    if (!XGetWindowAttributes(display, xwindow, &attributes))
+        return NULL;
+    VisualID visual = XVisualIDFromVisual(attributes.visual);
+
+    if (create_context_attribs)
+    {
+        int config_attribs[] = {GLX_X_RENDERABLE, True, GLX_DRAWABLE_TYPE, GLX_WINDOW_BIT,
+                                GLX_RENDER_TYPE, GLX_RGBA_BIT, GLX_DOUBLEBUFFER, True,
+                                GLX_RED_SIZE, 8, GLX_GREEN_SIZE, 8, GLX_BLUE_SIZE, 8,
+                                GLX_DEPTH_SIZE, 24, GLX_STENCIL_SIZE, 8, None};
+        int context_attribs[] = {GLX_CONTEXT_MAJOR_VERSION_ARB, 3, GLX_CONTEXT_MINOR_VERSION_ARB, 3,
+                                 GLX_CONTEXT_PROFILE_MASK_ARB, GLX_CONTEXT_CORE_PROFILE_BIT_ARB, None};
+        int count = 0;
+        GLXFBConfig *configs = glXChooseFBConfig(display, screen, config_attribs, &count);
+        GLXFBConfig config = NULL;
+        for (int i = 0; i < count && !config; i++)
+        {
+            int id = 0;
+            if (glXGetFBConfigAttrib(display, configs[i], GLX_VISUAL_ID, &id) == Success && (VisualID)id == visual)
+                config = configs[i];
+        }
+        GLXContext context = NULL;
+        if (config)
+        {
+            context_refused = TSDL_FALSE;
+            int (*previous)(Display *, XErrorEvent *) = XSetErrorHandler(context_error_handler);
+            context = create_context_attribs(display, config, NULL, True, context_attribs);
+            XSync(display, False);
+            XSetErrorHandler(previous);
+            if (context && context_refused)
+            {
+                glXDestroyContext(display, context);
+                context = NULL;
+            }
+        }
+        if (configs)
+            XFree(configs);
+        if (context)
+            return context;
+        LOG_WARN("OpenGL 3.3 core context unavailable; falling back to a legacy context");
+    }
+
+    XVisualInfo match = {.visualid = visual, .screen = screen};
+    int count = 0, rgba = 0, doublebuffer = 0;
+    XVisualInfo *vi = XGetVisualInfo(display, VisualIDMask | VisualScreenMask, &match, &count);
+    if (!vi)
+        return NULL;
+    GLXContext context = NULL;
+    if (glXGetConfig(display, vi, GLX_RGBA, &rgba) == 0 && rgba &&
+        glXGetConfig(display, vi, GLX_DOUBLEBUFFER, &doublebuffer) == 0 && doublebuffer)
+        context = glXCreateContext(display, vi, NULL, GL_TRUE);
+    XFree(vi);
+
+    return context;
+}
+int map_key_mods(int x11_mods)
+{
+    return mask_mods(mod_state, (unsigned int)x11_mods);
+}
 TSDL_Keycode map_keys(KeySym x11_key)
 {
     switch (x11_key)
@@ -846,7 +1856,18 @@ void tsdl_swapBuffers(window win)
         log_error(TSDL_ERR_WINDOW, "Invalid window for swap");
         return;
     }
+    if (render_thread_swap(win))
+        return;
+    if (idle_throttle(track_visible(&win->track)))
+        return;
+    capture_readback(win, win->track.w, win->track.h);
     glXSwapBuffers(win->display, win->xwindow);
+
+    int64_t ust, msc, sbc;
+    if (get_sync_values && get_sync_values(win->display, win->xwindow, &ust, &msc, &sbc))
+        frame_vblank(window_getDisplay(win), ust, msc, sbc);
+    else
+        frame_swapped(window_getDisplay(win));
 }
 void tsdl_clear(window win)
 {
@@ -855,7 +1876,9 @@ void tsdl_clear(window win)
         log_error(TSDL_ERR_WINDOW, "Invalid window for clear");
         return;
     }
-    glXMakeCurrent(win->display, win->xwindow, win->glx_context);
+    if (render_thread_clear(win))
+        return;
+    make_current(win);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 }
 void tsdl_clearColor(window win, float r, float g, float b, float a)
@@ -865,8 +1888,10 @@ void tsdl_clearColor(window win, float r, float g, float b, float a)
         log_error(TSDL_ERR_WINDOW, "Invalid window for clear color");
         return;
     }
-    glXMakeCurrent(win->display, win->xwindow, win->glx_context);
-    glClearColor(r, g, b, a);
+    if (render_thread_clearColor(win, r, g, b, a))
+        return;
+    make_current(win);
+    glstate_clearColor(r, g, b, a);
 }
 void tsdl_setViewport(window win, int x, int y, int w, int h)
 {
@@ -875,6 +1900,27 @@ void tsdl_setViewport(window win, int x, int y, int w, int h)
         log_error(TSDL_ERR_WINDOW, "Invalid window for viewport");
         return;
     }
-    glXMakeCurrent(win->display, win->xwindow, win->glx_context);
-    glViewport(x, y, w, h);
+    if (render_thread_viewport(win, x, y, w, h))
+        return;
+    make_current(win);
+    glstate_viewport(x, y, w, h);
+}
+void tsdl_getDrawableSize(window win, int *w, int *h)
+{
+    if (!win || !win->xwindow)
+    {
+        log_error(TSDL_ERR_WINDOW, "Invalid window for drawable size");
+        return;
+    }
+    *w = win->track.w;
+    *h = win->track.h;
+}
+void tsdl_makeCurrent(window win)
+{
+    make_current(win);
+}
+void tsdl_releaseCurrent(window win)
+{
+    glXMakeCurrent(win->display, None, NULL);
+    glstate_invalidate();
 }
\ No newline at end of file
@@ -0,0 +1,33 @@
+//  internal/tsdl_gl.h
+//  =========================================================================
+//  OpenGL entry points beyond 1.1 (buffers, syncs, shaders) are linked
+//  directly from libGL; include this before any other GL header.
+
+#ifndef TSDL_GL_H
+#define TSDL_GL_H
+
+#ifndef GL_GLEXT_PROTOTYPES
+#define GL_GLEXT_PROTOTYPES
+#endif
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#define TSDL_GLSTATE_UNITS 8 // Texture units shadowed by the state cache
+
+// GL state cache: redundant binds/sets are skipped (one shadow, for the current context)
+void glstate_invalidate(void);                               // Forget all shadowed state (context switch)
+void glstate_viewport(GLint, GLint, GLsizei, GLsizei);       // glViewport
+void glstate_clearColor(GLfloat, GLfloat, GLfloat, GLfloat); // glClearColor
+void glstate_activeTexture(GLenum);                          // glActiveTexture
+void glstate_bindTexture(GLenum, GLuint);                    // glBindTexture (GL_TEXTURE_2D is shadowed)
+void glstate_bindBuffer(GLenum, GLuint);                     // glBindBuffer (array and pixel buffers are shadowed)
+void glstate_useProgram(GLuint);                             // glUseProgram
+void glstate_bindVertexArray(GLuint);                        // glBindVertexArray
+void glstate_setBlend(GLboolean);                            // glEnable/glDisable(GL_BLEND)
+void glstate_blendFunc(GLenum, GLenum);                      // glBlendFunc
+void glstate_deleteTexture(GLuint);                          // glDeleteTextures, dropping shadowed bindings
+void glstate_deleteBuffer(GLuint);                           // glDeleteBuffers, dropping shadowed bindings
+void glstate_deleteProgram(GLuint);                          // glDeleteProgram, dropping the shadowed program
+void glstate_deleteVertexArray(GLuint);                      // glDeleteVertexArrays, dropping the shadowed VAO
+
+#endif // TSDL_GL_H
@@ -1,26 +1,148 @@
 //  internal/tsdl_rendering.h
 //  =========================================================================
 
+#ifndef TSDL_RENDERING_H
+#define TSDL_RENDERING_H
+
 #include "tinysdl.h"
 
+#define TSDL_CAPTURE_RING 3           // Max pixel buffers in flight for frame capture
+#define TSDL_RENDERER_MAX_QUADS 16384 // Quads per vertex region before an early flush
+#define TSDL_RENDERER_REGIONS 3       // Vertex regions cycled between flushes
+#define TSDL_ATLAS_MAX_PAGES 4        // Page textures per atlas
+#define TSDL_ATLAS_MAX_ENTRIES 4096   // Live entries per atlas
+
+/** @brief 8-bit RGBA color */
+typedef struct
+{
+    unsigned char r, g, b, a;
+} TSDL_Color;
+/** @brief Rectangle in window pixels (top-left origin) or normalized texture coordinates */
+typedef struct
+{
+    float x, y, w, h;
+} TSDL_Rect;
+/** @brief Counters from the last renderer flush */
+typedef struct
+{
+    unsigned long quads;      // Quads submitted
+    unsigned long items;      // Batch items after merging contiguous same-state quads
+    unsigned long draw_calls; // Draw calls issued
+} TSDL_RendererStats;
+/** @brief GL state cache counters */
+typedef struct
+{
+    unsigned long issued;  // Calls forwarded to the driver
+    unsigned long skipped; // Redundant calls dropped
+} TSDL_GLStateStats;
+/** @brief Present timing from recent swaps; times are seconds on CLOCK_MONOTONIC */
+typedef struct
+{
+    double last_present;  // Vblank the last completed swap was shown at
+    double next_vblank;   // Predicted next vblank after now (0 = no swaps timed yet)
+    double interval;      // Refresh interval of the window's monitor
+    unsigned long frames; // Swaps timed
+    unsigned long missed; // Vblanks that passed while a frame was due (jank)
+    int precise;          // TSDL_TRUE: GLX_OML_sync_control counters; TSDL_FALSE: CPU estimate
+} TSDL_FrameTiming;
+/** @brief Opaque handle to a batched 2D renderer */
+typedef struct tsdl_renderer_s *renderer;
+/** @brief Opaque handle to a texture atlas */
+typedef struct tsdl_atlas_s *atlas;
+/** @brief Atlas entry handle; 0 is invalid, evicted handles stop resolving */
+typedef unsigned int TSDL_AtlasId;
+/** @brief Where an atlas entry lives */
+typedef struct
+{
+    unsigned int texture; // Page texture to draw with
+    TSDL_Rect uv;         // Normalized texture rect
+    int x, y, w, h;       // Pixel rect within the page
+} TSDL_AtlasRegion;
+
+/** @brief GL work run on the render thread with the window's context current */
+typedef void (*TSDL_RenderCallback)(object user);
+
+/** @brief Frame capture output formats */
+typedef enum
+{
+    TSDL_CAPTURE_CALLBACK = 0, // Deliver mapped pixels to a callback
+    TSDL_CAPTURE_PPM = 1,      // Write a numbered P6 PPM sequence
+    TSDL_CAPTURE_RAW = 2,      // Write numbered raw RGBA frames (bottom-up rows)
+} TSDL_CaptureFormat;
+/** @brief Called with a completed frame; pixels are RGBA, bottom-up, valid only during the call */
+typedef void (*TSDL_CaptureCallback)(const unsigned char *pixels, int w, int h, unsigned long frame, object user);
+/** @brief Frame capture configuration */
+typedef struct
+{
+    TSDL_CaptureFormat format;     // Output format
+    TSDL_CaptureCallback callback; // Frame callback (TSDL_CAPTURE_CALLBACK)
+    object user;                   // User data passed to the callback
+    const char *path;              // printf-style frame path, e.g. "capture/frame_%05lu.ppm"
+    int latency;                   // Frames between readback and map (1..TSDL_CAPTURE_RING-1)
+} TSDL_CaptureConfig;
+
 #ifndef TSDL_X11
 void tsdl_swapBuffers(window);
 void tsdl_clear(window);
 void tsdl_clearColor(window, float, float, float, float);
 void tsdl_setViewport(window, int, int, int, int);
-#endif
 
-#ifdef TSDL_X11
-#include <X11/Xlib.h>
-struct test_renderer_s
-{
-    Display *display;
-    Window xwindow;
-    GC gc;
-};
-typedef struct test_renderer_s *renderer;
+// Render thread: while running, clear/viewport/swap are queued to the thread that owns the context
+int tsdl_startRenderThread(window, int);                 // Hand the context to a render thread (frames in flight)
+void tsdl_stopRenderThread(window);                      // Drain the queue, join and take the context back
+void tsdl_runOnRenderThread(TSDL_RenderCallback, object); // Queue GL work (renderer, atlas, capture); inline when off
+
+// GL state cache
+TSDL_GLStateStats tsdl_getGLStateStats(void); // Counters since start or last reset
+void tsdl_resetGLStateStats(void);            // Zero the counters
+
+// Idle pacing and frame timing
+void tsdl_setIdleRate(int);                 // Drop swaps and sleep to this rate while the window can't be seen (0 = off)
+TSDL_FrameTiming tsdl_getFrameTiming(void); // Last present, predicted next vblank and missed frames
+void tsdl_resetFrameTiming(void);           // Zero the frame and missed counters
+
+// Late latch: beginFrame, poll events, draw, endFrame
+void tsdl_setLateLatch(int);  // Start frames this many us plus the recent frame cost before the predicted vblank (0 = off)
+void tsdl_beginFrame(window); // Wait for the latch point, if set; poll input after this
+void tsdl_endFrame(window);   // Swap, and learn how long the frame took
+
+// Frame capture
+int tsdl_beginCapture(window, const TSDL_CaptureConfig *); // Start async readback on swap
+void tsdl_endCapture(window);                              // Drain pending frames and stop
+unsigned long tsdl_getCaptureDropped(void);                // Frames skipped to avoid a stall
+
+// Batched 2D renderer
+renderer create_renderer(window);                                                    // Create a renderer on the window's current context
+void update_renderer(renderer);                                                      // Flush the batch (sorted by layer, then texture)
+void destroy_renderer(renderer);                                                     // Destroy a renderer and its GL objects
+void renderer_setLayer(renderer, int);                                               // Layer for following draws; order is kept across layers only
+void renderer_fillRect(renderer, TSDL_Rect, TSDL_Color);                             // Filled rectangle
+void renderer_drawRect(renderer, TSDL_Rect, float, TSDL_Color);                      // Rectangle outline (thickness)
+void renderer_drawLine(renderer, float, float, float, float, float, TSDL_Color);     // Line (x0, y0, x1, y1, thickness)
+void renderer_drawTexture(renderer, unsigned int, TSDL_Rect, TSDL_Rect, TSDL_Color); // Textured quad (texture, uv, dst, tint)
+TSDL_RendererStats renderer_getStats(renderer);                                      // Counters from the last flush
+
+// Texture atlas
+atlas create_atlas(int, int, int);                              // Create an atlas (page w, page h, max pages)
+void destroy_atlas(atlas);                                      // Destroy an atlas and its page textures
+TSDL_AtlasId atlas_add(atlas, int, int, const unsigned char *); // Pack and upload an RGBA image (w, h, pixels)
+int atlas_get(atlas, TSDL_AtlasId, TSDL_AtlasRegion *);         // Resolve an entry and mark its page used; TSDL_FALSE if evicted
+void atlas_remove(atlas, TSDL_AtlasId);                         // Free an entry
+void atlas_nextFrame(atlas);                                    // Advance the LRU clock (once per frame)
+
+// Backend hooks
+void capture_readback(window, int, int);                          // Called by the backend before presenting (w, h)
+void tsdl_getDrawableSize(window, int *, int *);                  // Current drawable size in pixels
+void tsdl_makeCurrent(window);                                    // Make the window's context current on this thread
+void tsdl_releaseCurrent(window);                                 // Release the window's context from this thread
+int render_thread_owns(window);                                   // TSDL_TRUE while a render thread holds the context
+int render_thread_clear(window);                                  // Forward to the render thread; TSDL_FALSE to run inline
+int render_thread_clearColor(window, float, float, float, float); // "
+int render_thread_viewport(window, int, int, int, int);           // "
+int render_thread_swap(window);                                   // "
+int idle_throttle(int);                                           // Called by the backend before presenting (visible); TSDL_TRUE = skip it
+void frame_swapped(int);                                          // Called by the backend after presenting without OML (display)
+void frame_vblank(int, long long, long long, long long);          // Called by the backend after presenting (display, ust, msc, sbc)
+#endif
 
-renderer create_renderer(window);
-void update_renderer(renderer);
-void destroy_renderer(renderer);
-#endif // TSDL_X11
\ No newline at end of file
+#endif // TSDL_RENDERING_H
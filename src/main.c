@@ -1,15 +1,39 @@
 // src/main.c
 #include "tinysdl.h"
 #include <sigcore.h>
+#include <locale.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 //  internal
 #include "internal/tsdl_rendering.h"
 
-int main(void)
+static void begin_capture(object win)
+{
+	static const TSDL_CaptureConfig capture = {
+		.format = TSDL_CAPTURE_PPM,
+		.path = "frame_%05lu.ppm",
+		.latency = 2,
+	};
+	tsdl_beginCapture(win, &capture);
+}
+static void end_capture(object win)
+{
+	tsdl_endCapture(win);
+}
+
+int main(int argc, char **argv)
 {
 	LOG_STAT("Launching Test Application");
 	int running = 0;
+	int capturing = 0;
+	int threaded = 0;
+	int relative = 0;
+	int latched = 0;
+
+	//	the user's locale picks the compose table for text input
+	setlocale(LC_CTYPE, "");
 
 	// Initialize TinySDL with video subsystem
 	if (TinySDL.init_video() != 0)
@@ -20,6 +44,16 @@ int main(void)
 
 	LOG_STAT("backend=%s version=%s", TSDL_BACKEND, TinySDL.getVersion());
 
+	//	joysticks are optional; carry on without them
+	if (TinySDL.init(TSDL_INIT_JOYSTICK) != 0)
+		LOG_STAT("[TinySDL] Joysticks unavailable: %s", TinySDL.getError());
+
+	//	--record <log> captures this session's input; --replay <log> [speed] feeds one back
+	if (argc >= 3 && strcmp(argv[1], "--record") == 0)
+		TinySDL.recordEvents(argv[2]);
+	else if (argc >= 3 && strcmp(argv[1], "--replay") == 0)
+		TinySDL.replayEvents(argv[2], argc >= 4 ? atof(argv[3]) : 1.0);
+
 	// Create a window
 	window win = TinySDL.window->create("TinySDL Window", 100, 100, 800, 600, TSDL_WINDOW_SHOWN | TSDL_WINDOW_CENTERED | TSDL_WINDOW_RESIZABLE | TSDL_WINDOW_FULLSCREEN);
 	if (!win)
@@ -29,14 +63,27 @@ int main(void)
 		return -1;
 	}
 
+	//	the monitor the window landed on
+	TSDL_DisplayInfo display;
+	if (TinySDL.getDisplay(TinySDL.window->getDisplay(win), &display))
+		LOG_STAT("Display %s: %dx%d+%d+%d @ %.2f Hz, scale %.2f", display.name, display.w, display.h, display.x, display.y, display.refresh, display.scale);
+
+	//	nothing to draw while minimized or covered; idle at 10 Hz instead of spinning
+	tsdl_setIdleRate(10);
+
 	//	we got this far; let's start the event loop
 	running = 1;
 	TSDL_Event event;
 	LOG_STAT("Starting event loop");
 	while (running)
 	{
-		tsdl_clear(win);
-		tsdl_clearColor(win, 0.2f, 0.3f, 0.3f, 1.0f);
+		//	with the late latch on, this waits until just before the vblank so input below is fresh
+		tsdl_beginFrame(win);
+		if (TinySDL.window->isVisible(win))
+		{
+			tsdl_clear(win);
+			tsdl_clearColor(win, 0.2f, 0.3f, 0.3f, 1.0f);
+		}
 
 		while (TinySDL.pollEvent(&event))
 		{
@@ -57,18 +104,57 @@ int main(void)
 				case TSDL_KEY_F11:
 					TinySDL.window->toggleFullscreen(win);
 
+					break;
+				case TSDL_KEY_F7:
+					latched = !latched;
+					tsdl_setLateLatch(latched ? 2000 : 0);
+					LOG_STAT("Late latch=%d", latched);
+
+					break;
+				case TSDL_KEY_F8:
+				{
+					TSDL_FrameTiming timing = tsdl_getFrameTiming();
+					LOG_STAT("Frames=%lu missed=%lu interval=%.3f ms (%s)", timing.frames, timing.missed,
+							 timing.interval * 1000.0, timing.precise ? "OML" : "estimated");
+				}
+
+				break;
+				case TSDL_KEY_F9:
+					relative = !relative;
+					TinySDL.window->setRelativeMouse(win, relative);
+
+					break;
+				case TSDL_KEY_F10:
+					if (threaded)
+					{
+						tsdl_stopRenderThread(win);
+						threaded = TSDL_FALSE;
+					}
+					else if (tsdl_startRenderThread(win, 1) == TSDL_ERR_NONE)
+					{
+						threaded = TSDL_TRUE;
+					}
+					else
+					{
+						LOG_STAT("[TinySDL] Render thread unavailable");
+					}
+
+					break;
+				case TSDL_KEY_F12:
+					//	capture runs GL; route it to whichever thread owns the context
+					tsdl_runOnRenderThread(capturing ? end_capture : begin_capture, win);
+					capturing = !capturing;
+
 					break;
 				}
 
 				break;
 			case TSDL_EVENT_WINDOW_MOVED:
-				LOG_STAT("Moved:");
-				printf("   %d x %d\n", event.data.window_moved.x, event.data.window_moved.y);
+				LOG_STAT("Moved: %d x %d", event.data.window_moved.x, event.data.window_moved.y);
 
 				break;
 			case TSDL_EVENT_WINDOW_RESIZED:
-				LOG_STAT("Resized:");
-				printf("   %d x %d\n", event.data.window_resized.w, event.data.window_resized.h);
+				LOG_STAT("Resized: %d x %d", event.data.window_resized.w, event.data.window_resized.h);
 				tsdl_setViewport(win, 0, 0, event.data.window_resized.w, event.data.window_resized.h);
 
 				break;
@@ -95,50 +181,75 @@ int main(void)
 			case TSDL_EVENT_WINDOW_EXPOSED:
 				LOG_STAT("Window exposed");
 
+				break;
+			case TSDL_EVENT_WINDOW_OCCLUDED:
+				LOG_STAT("Window occluded");
+
 				break;
 			case TSDL_EVENT_MOUSE_BUTTON_DOWN:
-				LOG_STAT("Mouse down:");
-				printf("   button=%d, mods=%d\n", event.data.mouse_button.button, event.data.mouse_button.mods);
+				LOG_STAT("Mouse down: button=%d, mods=%d", event.data.mouse_button.button, event.data.mouse_button.mods);
 
 				break;
 			case TSDL_EVENT_MOUSE_BUTTON_UP:
-				LOG_STAT("Mouse up:");
-				printf("   button=%d, mods=%d\n", event.data.mouse_button.button, event.data.mouse_button.mods);
+				LOG_STAT("Mouse up: button=%d, mods=%d", event.data.mouse_button.button, event.data.mouse_button.mods);
 
 				break;
 			case TSDL_EVENT_MOUSE_MOVED:
-				LOG_STAT("Mouse moved:");
-				printf("   x=%.1d, y=%.1d\n", event.data.mouse_moved.x, event.data.mouse_moved.y);
+				LOG_STAT("Mouse moved: x=%d, y=%d", event.data.mouse_moved.x, event.data.mouse_moved.y);
+
+				break;
+			case TSDL_EVENT_MOUSE_RELATIVE:
+				LOG_STAT("Mouse relative: dx=%.2f, dy=%.2f", event.data.mouse_relative.dx, event.data.mouse_relative.dy);
 
 				break;
 			case TSDL_EVENT_MOUSE_WHEEL:
-				LOG_STAT("Mouse wheel:");
-				printf("   xoffset=%.1f, yoffset=%.1f\n", event.data.mouse_wheel.xoffset, event.data.mouse_wheel.yoffset);
+				LOG_STAT("Mouse wheel: xoffset=%.1f, yoffset=%.1f", event.data.mouse_wheel.xoffset, event.data.mouse_wheel.yoffset);
 
 				break;
 			case TSDL_EVENT_DROP:
 				/*
 				 *		Drop event
-				 *		- paths: list of dropped paths -- user shouold copy the strings if persistence is
-				 *		  necessary. The backend will free the list and its contents when the next event
-				 *		  is processed.
+				 *		- paths: views into one block holding every dropped path -- user should copy the
+				 *		  strings if persistence is necessary. The block is freed when the next event
+				 *		  is polled.
 				 */
-				LOG_STAT("Files dropped:");
-				iterator it = Array.getIterator(event.data.drop.paths, LIST);
-				while (Iterator.hasNext(it))
+				LOG_STAT("Files dropped: %d", event.data.drop.count);
+				for (int i = 0; i < event.data.drop.count; i++)
 				{
-					string path = Iterator.next(it);
-					printf("   %s\n", path);
+					LOG_STAT("   %.*s", (int)event.data.drop.paths[i].len, event.data.drop.paths[i].str);
 				}
-				Iterator.free(it);
+
+				break;
+			case TSDL_EVENT_TEXT_INPUT:
+				LOG_STAT("Text input: \"%s\"", event.data.text.text);
+
+				break;
+			case TSDL_EVENT_DISPLAY_ADDED:
+			case TSDL_EVENT_DISPLAY_REMOVED:
+			case TSDL_EVENT_DISPLAY_CHANGED:
+				LOG_STAT("Display %s: which=%d", event.type == TSDL_EVENT_DISPLAY_ADDED ? "added" : (event.type == TSDL_EVENT_DISPLAY_REMOVED ? "removed" : "changed"), event.data.display.which);
+
+				break;
+			case TSDL_EVENT_JOY_ADDED:
+			case TSDL_EVENT_JOY_REMOVED:
+				LOG_STAT("Joystick %s: which=%d", event.type == TSDL_EVENT_JOY_ADDED ? "added" : "removed", event.data.joy_device.which);
+
+				break;
+			case TSDL_EVENT_JOY_AXIS:
+				LOG_STAT("Joystick axis: which=%d, axis=%d, value=%.3f", event.data.joy_axis.which, event.data.joy_axis.axis, event.data.joy_axis.value);
+
+				break;
+			case TSDL_EVENT_JOY_BUTTON_DOWN:
+			case TSDL_EVENT_JOY_BUTTON_UP:
+				LOG_STAT("Joystick button %s: which=%d, button=%d", event.type == TSDL_EVENT_JOY_BUTTON_DOWN ? "down" : "up", event.data.joy_button.which, event.data.joy_button.button);
 
 				break;
 			default:
 				break;
 			}
 		}
-		//	rendering
-		tsdl_swapBuffers(win);
+		//	rendering; dropped (and paced) while the window can't be seen
+		tsdl_endFrame(win);
 	}
 
 	TinySDL.quit();
@@ -10,7 +10,14 @@
  */
 
 #include "tinysdl.h"
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #ifdef TSDL_MOCK
 #include "tinysdl_mock.h"
@@ -18,24 +25,94 @@
 #include "tinysdl_core.h"
 #endif
 
-char err_trace[TSDL_ERROR_SIZE] = "";
+#define POSTED_EVENTS 1024  // Capacity of the posted event queue (power of two)
+#define LOG_LINES 256       // Pending log lines (power of two)
+#define LOG_LINE_SIZE 160   // Bytes per log line, truncated beyond
+#define LOG_BATCH_SIZE 8192 // Bytes the sink writes per batch
+#define JOY_WAIT_SLICE 8    // ms waitEvent sleeps between joystick polls
 
-// Shared Helper Functions ====================================================
-TSDL_ErrorState log_error(TSDL_ErrorState err_state, const string msg)
+/*
+    Posted events: a bounded multi-producer/single-consumer queue. Each
+    cell carries a sequence number; producers claim a position with one
+    CAS on head and publish by bumping the cell's sequence, so posting
+    never takes a lock and never allocates. Only pollEvent (the consumer)
+    moves tail.
+ */
+typedef struct
 {
-    static string format = "[TinySDL] Error(%d): %s\n";
-    size_t current_len = strlen(err_trace);
-    size_t remaining = TSDL_ERROR_SIZE - current_len - 1; // -1 for null terminator
-    if (remaining > 0)
-    {
-        snprintf(err_trace + current_len, remaining, format, err_state, msg);
-    }
+    _Atomic size_t seq; // Position this cell is ready for
+    TSDL_Event event;   // Posted event
+} posted_cell;
 
-    return err_state;
+static struct
+{
+    posted_cell cells[POSTED_EVENTS]; // Ring storage
+    _Atomic size_t head;              // Next position to claim (producers)
+    size_t tail;                      // Next position to read (consumer)
+} posted;
+
+/** @brief A registered filter or watch */
+typedef struct
+{
+    TSDL_EventFilter fn; // Callback
+    object user;         // User data passed back to it
+} event_hook;
+
+/*
+    Errors: each thread records into its own ring, so recording is a few
+    stores with no lock and no allocation. The text for getError is only
+    formatted when someone asks for it.
+ */
+static _Thread_local struct
+{
+    TSDL_ErrorRecord records[TSDL_ERROR_RING]; // Ring storage
+    unsigned int count;                        // Records since the last clear
+    char text[TSDL_ERROR_SIZE];                // getError output
+} errors;
+
+/*
+    Log sink: log_write formats the message into a slot of a bounded MPSC
+    ring (same scheme as posted events) and returns; the sink thread adds
+    the prefix and writes whole batches with one fwrite/fflush. The caller
+    never touches stdio. When the ring is full the line is counted as
+    dropped instead of blocking.
+ */
+typedef struct
+{
+    _Atomic size_t seq;       // Position this cell is ready for
+    int level;                // TSDL_LOG_* level
+    char text[LOG_LINE_SIZE]; // Formatted message
+} log_cell;
+
+static struct
+{
+    log_cell cells[LOG_LINES];     // Ring storage
+    _Atomic size_t head;           // Next position to claim (producers)
+    size_t tail;                   // Next position to write (sink thread)
+    _Atomic unsigned long dropped; // Lines lost to a full ring
+    _Atomic int idle;              // Sink is (about to be) asleep on wake
+    _Atomic int stopping;          // Drain and exit
+    sem_t wake;                    // Wakes the sink thread
+    pthread_t thread;              // Sink thread
+    pthread_once_t once;           // Starts the sink on first use
+} sink = {.once = PTHREAD_ONCE_INIT};
+
+static unsigned int disabled_events = 0; // Bit per built-in TSDL_EventType
+static TSDL_Event delivered_drop = {0}; // Drop handed out by the last poll; freed on the next
+static event_hook event_filter = {0};
+static event_hook event_watches[TSDL_MAX_EVENT_WATCHES];
+static int watch_count = 0;
+
+// Log Sink Helpers ==========================================================
+static int log_ready(void)
+{
+    log_cell *cell = &sink.cells[sink.tail & (LOG_LINES - 1)];
+    return atomic_load(&cell->seq) == sink.tail + 1;
 }
-void log_stat(const string msg)
+/* Write every published line as one batch */
+static void log_drain(void)
 {
-    static string format = "[TinySDL%s] %s\n";
+    static const char *tags[] = {"trace: ", "", "info: ", "warn: "};
     const char *backend = "";
 #ifdef TSDL_MOCK
     backend = " :: Mock";
@@ -45,10 +122,166 @@ void log_stat(const string msg)
     backend = " :: OpenGL";
 #endif
 
-    fprintf(stdout, format, backend, msg);
-    fflush(stdout);
+    char batch[LOG_BATCH_SIZE];
+    size_t used = 0;
+    while (log_ready())
+    {
+        log_cell *cell = &sink.cells[sink.tail & (LOG_LINES - 1)];
+        if (used + LOG_LINE_SIZE + 32 > sizeof(batch))
+        {
+            fwrite(batch, 1, used, stdout);
+            used = 0;
+        }
+        int level = cell->level >= TSDL_LOG_TRACE && cell->level <= TSDL_LOG_WARN ? cell->level : TSDL_LOG_WARN;
+        used += (size_t)snprintf(batch + used, sizeof(batch) - used, "[TinySDL%s] %s%s\n", backend, tags[level], cell->text);
+        atomic_store_explicit(&cell->seq, sink.tail + LOG_LINES, memory_order_release);
+        sink.tail++;
+    }
+
+    unsigned long dropped = atomic_exchange(&sink.dropped, 0);
+    if (dropped && used + LOG_LINE_SIZE + 32 > sizeof(batch))
+    {
+        fwrite(batch, 1, used, stdout);
+        used = 0;
+    }
+    if (dropped)
+        used += (size_t)snprintf(batch + used, sizeof(batch) - used, "[TinySDL%s] warn: %lu log lines dropped\n", backend, dropped);
+    if (used)
+    {
+        fwrite(batch, 1, used, stdout);
+        fflush(stdout);
+    }
 }
-list copy_drop_paths(int count, const char **paths)
+static void *log_main(object arg)
+{
+    for (;;)
+    {
+        log_drain();
+        if (atomic_load(&sink.stopping))
+            break;
+
+        // announce the sleep, then re-check so a line published meanwhile isn't missed
+        atomic_store(&sink.idle, TSDL_TRUE);
+        if (!log_ready() && !atomic_load(&sink.stopping))
+        {
+            while (sem_wait(&sink.wake) != 0)
+                ; // EINTR
+        }
+        atomic_store(&sink.idle, TSDL_FALSE);
+    }
+    log_drain();
+
+    return NULL;
+}
+static void stop_log_sink(void)
+{
+    atomic_store(&sink.stopping, TSDL_TRUE);
+    sem_post(&sink.wake);
+    pthread_join(sink.thread, NULL);
+    sem_destroy(&sink.wake);
+}
+static void start_log_sink(void)
+{
+    sem_init(&sink.wake, 0, 0);
+    if (pthread_create(&sink.thread, NULL, log_main, NULL) != 0)
+    {
+        atomic_store(&sink.stopping, TSDL_TRUE); // no sink: drop lines rather than block
+        return;
+    }
+    atexit(stop_log_sink); // flush what's queued on exit
+}
+
+// Shared Helper Functions ====================================================
+TSDL_ErrorState record_error(TSDL_ErrorState err_state, const char *msg, const char *file, int line)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now); // vDSO; no syscall
+
+    TSDL_ErrorRecord *record = &errors.records[errors.count++ & (TSDL_ERROR_RING - 1)];
+    record->code = err_state;
+    record->msg = msg;
+    record->file = file;
+    record->line = line;
+    record->time = (unsigned long long)now.tv_sec * 1000000000ull + (unsigned long long)now.tv_nsec;
+
+    return err_state;
+}
+const string get_error(void)
+{
+    static const char *format = "[TinySDL] Error(%d): %s (%s:%d)\n";
+    unsigned int kept = errors.count < TSDL_ERROR_RING ? errors.count : TSDL_ERROR_RING;
+
+    // keep the newest records that fit, then print them oldest first
+    size_t used = 0;
+    unsigned int first = errors.count;
+    for (unsigned int i = 0; i < kept; i++)
+    {
+        const TSDL_ErrorRecord *r = &errors.records[(errors.count - 1 - i) & (TSDL_ERROR_RING - 1)];
+        size_t len = (size_t)snprintf(NULL, 0, format, r->code, r->msg, r->file, r->line);
+        if (used + len >= TSDL_ERROR_SIZE)
+            break;
+        used += len;
+        first--;
+    }
+
+    char *cursor = errors.text;
+    errors.text[0] = '\0';
+    for (unsigned int i = first; i != errors.count; i++)
+    {
+        const TSDL_ErrorRecord *r = &errors.records[i & (TSDL_ERROR_RING - 1)];
+        cursor += snprintf(cursor, TSDL_ERROR_SIZE - (cursor - errors.text), format, r->code, r->msg, r->file, r->line);
+    }
+
+    return errors.text;
+}
+const TSDL_ErrorRecord *last_error(void)
+{
+    return errors.count ? &errors.records[(errors.count - 1) & (TSDL_ERROR_RING - 1)] : NULL;
+}
+void clear_error(void)
+{
+    errors.count = 0;
+}
+void log_write(int level, const char *fmt, ...)
+{
+    pthread_once(&sink.once, start_log_sink);
+    if (atomic_load_explicit(&sink.stopping, memory_order_relaxed))
+        return;
+
+    log_cell *cell;
+    size_t pos = atomic_load_explicit(&sink.head, memory_order_relaxed);
+    for (;;)
+    {
+        cell = &sink.cells[pos & (LOG_LINES - 1)];
+        size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&sink.head, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+        {
+            atomic_fetch_add_explicit(&sink.dropped, 1, memory_order_relaxed);
+            return;
+        }
+        else
+        {
+            pos = atomic_load_explicit(&sink.head, memory_order_relaxed);
+        }
+    }
+
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(cell->text, LOG_LINE_SIZE, fmt, args);
+    va_end(args);
+    cell->level = level;
+    atomic_store(&cell->seq, pos + 1);
+
+    if (atomic_exchange(&sink.idle, TSDL_FALSE))
+        sem_post(&sink.wake);
+}
+TSDL_StringView *copy_drop_paths(int count, const char **paths)
 {
     if (count <= 0 || !paths)
     {
@@ -56,56 +289,234 @@ list copy_drop_paths(int count, const char **paths)
         return NULL;
     }
 
-    list path_list = List.new(count);
-    if (!path_list)
+    // one block: the view table, then every path packed NUL-terminated
+    size_t table = sizeof(TSDL_StringView) * count;
+    size_t size = table;
+    for (int i = 0; i < count; i++)
+    {
+        size += (paths[i] ? strlen(paths[i]) : 0) + 1;
+    }
+    TSDL_StringView *views = Mem.alloc(size);
+    if (!views)
     {
-        log_error(TSDL_ERR, "Failed to create list for paths");
+        log_error(TSDL_ERR, "Failed to allocate drop payload");
         return NULL;
     }
-    string p = NULL;
+
+    char *cursor = (char *)views + table;
     for (int i = 0; i < count; i++)
     {
-        p = strdup(paths[i]);
-        if (!p)
-        {
-            log_error(TSDL_ERR, "Failed to copy path");
-            // I'm not cleaning up here because there could be other paths already added
-            // or valid paths that follow. List will be cleaned up before the next event
-            // is processed or when the program exits.
-        }
+        size_t len = paths[i] ? strlen(paths[i]) : 0;
+        memcpy(cursor, paths[i] ? paths[i] : "", len + 1);
+        views[i].str = cursor;
+        views[i].len = len;
+        cursor += len + 1;
+    }
+
+    LOG_TRACE("Copied %d drop paths (%zu bytes)", count, size);
+
+    return views;
+}
+TSDL_StringView *pack_drop_paths(int count, const char *packed, size_t size)
+{
+    if (count <= 0 || !packed)
+    {
+        log_error(TSDL_ERR, "Invalid packed paths or count");
+        return NULL;
+    }
 
-        LOG_STAT("Adding Path[%d]=%s", i, p);
-        // Debug log
+    // same layout as copy_drop_paths; the strings are already packed
+    size_t table = sizeof(TSDL_StringView) * count;
+    TSDL_StringView *views = Mem.alloc(table + size);
+    if (!views)
+    {
+        log_error(TSDL_ERR, "Failed to allocate drop payload");
+        return NULL;
+    }
 
-        List.add(path_list, p);
+    char *cursor = (char *)views + table;
+    memcpy(cursor, packed, size);
+    for (int i = 0; i < count; i++)
+    {
+        views[i].str = cursor;
+        views[i].len = strlen(cursor);
+        cursor += views[i].len + 1;
     }
 
-    return path_list;
+    return views;
 }
 void clear_drop_paths(Event ev)
 {
     if (ev->type == TSDL_EVENT_DROP && ev->data.drop.paths)
     {
-        LOG_STAT("Clearing drop paths");
-        for (int i = 0; i < ev->data.drop.count; i++)
-        {
-            String.free(List.getAt(ev->data.drop.paths, i));
-        }
-        List.clear(ev->data.drop.paths);
-        List.free(ev->data.drop.paths);
+        LOG_TRACE("Clearing drop paths");
+        Mem.free((object)ev->data.drop.paths);
         ev->data.drop.count = 0;
         ev->data.drop.paths = NULL;
     }
 }
+int utf8_encode(unsigned int codepoint, char *out)
+{
+    if (codepoint < 0x80)
+    {
+        out[0] = (char)codepoint;
+        return 1;
+    }
+    if (codepoint < 0x800)
+    {
+        out[0] = (char)(0xC0 | (codepoint >> 6));
+        out[1] = (char)(0x80 | (codepoint & 0x3F));
+        return 2;
+    }
+    if (codepoint >= 0xD800 && codepoint <= 0xDFFF)
+        return 0; // surrogate halves aren't characters
+    if (codepoint < 0x10000)
+    {
+        out[0] = (char)(0xE0 | (codepoint >> 12));
+        out[1] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (codepoint & 0x3F));
+        return 3;
+    }
+    if (codepoint < 0x110000)
+    {
+        out[0] = (char)(0xF0 | (codepoint >> 18));
+        out[1] = (char)(0x80 | ((codepoint >> 12) & 0x3F));
+        out[2] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+        out[3] = (char)(0x80 | (codepoint & 0x3F));
+        return 4;
+    }
+
+    return 0;
+}
+int append_text(Event text, const char *utf8, int len)
+{
+    if (text->type != TSDL_EVENT_TEXT_INPUT)
+    {
+        text->type = TSDL_EVENT_TEXT_INPUT;
+        text->data.text.text[0] = '\0';
+    }
+
+    // whole code points only; returns the bytes taken so the caller can deliver and continue
+    char *dst = text->data.text.text;
+    int used = (int)strlen(dst), taken = 0;
+    while (taken < len)
+    {
+        unsigned char lead = (unsigned char)utf8[taken];
+        if ((lead & 0xC0) == 0x80)
+        {
+            taken++; // stray continuation byte
+            continue;
+        }
+        int size = lead < 0x80 ? 1 : (lead < 0xE0 ? 2 : (lead < 0xF0 ? 3 : 4));
+        if (taken + size > len)
+        {
+            taken = len; // truncated sequence
+            break;
+        }
+        if (used + size >= TSDL_TEXT_INPUT_SIZE)
+            break;
+        memcpy(dst + used, utf8 + taken, size);
+        used += size;
+        taken += size;
+    }
+    dst[used] = '\0';
+
+    return taken;
+}
+void track_init(TSDL_WindowTracker *track, int x, int y, int w, int h, int flags)
+{
+    memset(track, 0, sizeof(TSDL_WindowTracker));
+    track->visible = (flags & TSDL_WINDOW_SHOWN) ? TSDL_TRUE : TSDL_FALSE;
+    track->maximized = (flags & TSDL_WINDOW_MAXIMIZED) ? TSDL_TRUE : TSDL_FALSE;
+    track->fullscreen = (flags & TSDL_WINDOW_FULLSCREEN) ? TSDL_TRUE : TSDL_FALSE;
+    track->x = track->normal.x = x;
+    track->y = track->normal.y = y;
+    track->w = track->normal.w = w;
+    track->h = track->normal.h = h;
+
+    // what the window was created as is not a transition
+    track->shown = track->fullscreen ? TSDL_WINDOW_STATE_FULLSCREEN
+                                     : (track->maximized ? TSDL_WINDOW_STATE_MAXIMIZED : TSDL_WINDOW_STATE_NORMAL);
+    track->state = track->visible ? track->shown : TSDL_WINDOW_STATE_HIDDEN;
+}
+int track_state(TSDL_WindowTracker *track, Event event)
+{
+    TSDL_WindowState next = TSDL_WINDOW_STATE_NORMAL;
+    if (track->minimized)
+        next = TSDL_WINDOW_STATE_MINIMIZED;
+    else if (!track->visible)
+        next = TSDL_WINDOW_STATE_HIDDEN;
+    else if (track->fullscreen)
+        next = TSDL_WINDOW_STATE_FULLSCREEN;
+    else if (track->maximized)
+        next = TSDL_WINDOW_STATE_MAXIMIZED;
+    track->state = next;
+
+    // hiding is passed through silently, so unmap + iconify + map reads as minimize + restore
+    if (next == TSDL_WINDOW_STATE_HIDDEN || next == track->shown)
+        return TSDL_FALSE;
+    LOG_TRACE("Window state %d -> %d", track->shown, next);
+    track->shown = next;
+
+    switch (next)
+    {
+    case TSDL_WINDOW_STATE_MINIMIZED:
+        event->type = TSDL_EVENT_WINDOW_MINIMIZED;
+        return TSDL_TRUE;
+    case TSDL_WINDOW_STATE_MAXIMIZED:
+        event->type = TSDL_EVENT_WINDOW_MAXIMIZED;
+        return TSDL_TRUE;
+    case TSDL_WINDOW_STATE_NORMAL:
+        event->type = TSDL_EVENT_WINDOW_RESTORED;
+        return TSDL_TRUE;
+    default:
+        return TSDL_FALSE; // fullscreen is reported by WINDOW_RESIZED.is_fullscreen
+    }
+}
+int track_geometry(TSDL_WindowTracker *track, int x, int y, int w, int h, Event event)
+{
+    int resized = w != track->w || h != track->h;
+    int moved = x != track->x || y != track->y;
+    track->x = x;
+    track->y = y;
+    track->w = w;
+    track->h = h;
+    if (track->state == TSDL_WINDOW_STATE_NORMAL)
+    {
+        track->normal.x = x;
+        track->normal.y = y;
+        track->normal.w = w;
+        track->normal.h = h;
+    }
+
+    if (resized)
+    {
+        event->type = TSDL_EVENT_WINDOW_RESIZED;
+        event->data.window_resized.w = w;
+        event->data.window_resized.h = h;
+        event->data.window_resized.is_fullscreen = track->state == TSDL_WINDOW_STATE_FULLSCREEN;
+        return TSDL_TRUE;
+    }
+    if (moved)
+    {
+        event->type = TSDL_EVENT_WINDOW_MOVED;
+        event->data.window_moved.x = x;
+        event->data.window_moved.y = y;
+        return TSDL_TRUE;
+    }
+
+    return TSDL_FALSE; // configure without a change (restacking, WM pings)
+}
+int track_visible(const TSDL_WindowTracker *track)
+{
+    return track->visible && !track->minimized && !track->occluded;
+}
 Event create_event(TSDL_EventType type)
 {
     Event event = (Event)Mem.alloc(sizeof(TSDL_Event));
     if (!event)
     {
-        LOG_STAT("Failed to allocate memory for event [type=%d", type);
-        log_error(TSDL_ERR, logBuffer);
-        LOG_STAT("%s", tsdl_getError());
-
+        log_error(TSDL_ERR, "Failed to allocate memory for event");
         return NULL;
     }
     memset(event, 0, sizeof(TSDL_Event));
@@ -113,6 +524,295 @@ Event create_event(TSDL_EventType type)
 
     return event;
 }
+int event_enabled(TSDL_EventType type)
+{
+    return type >= 32 || !(disabled_events & (1u << type));
+}
+int dispatch_event(Event event)
+{
+    // backends stop most disabled types at the source; this catches the rest
+    if (!event_enabled(event->type))
+        return TSDL_FALSE;
+    if (event_filter.fn && !event_filter.fn(event_filter.user, event))
+        return TSDL_FALSE;
+
+    // watches observe; they get a copy so they can't rewrite what gets queued
+    for (int i = 0; i < watch_count; i++)
+    {
+        TSDL_Event copy = *event;
+        event_watches[i].fn(event_watches[i].user, &copy);
+    }
+
+    return TSDL_TRUE;
+}
+int post_event(const TSDL_Event *event)
+{
+    if (!event || event->type == TSDL_EVENT_NONE)
+    {
+        log_error(TSDL_ERR, "Attempt to post an empty event");
+        return TSDL_FALSE;
+    }
+    // filtered on the posting thread, before it takes a queue slot
+    TSDL_Event filtered = *event;
+    if (!dispatch_event(&filtered))
+        return TSDL_TRUE;
+
+    posted_cell *cell;
+    size_t pos = atomic_load_explicit(&posted.head, memory_order_relaxed);
+    for (;;)
+    {
+        cell = &posted.cells[pos & (POSTED_EVENTS - 1)];
+        size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&posted.head, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+        {
+            // full; the caller may retry once the main thread has drained
+            log_error(TSDL_ERR, "Posted event queue full");
+            return TSDL_FALSE;
+        }
+        else
+        {
+            pos = atomic_load_explicit(&posted.head, memory_order_relaxed);
+        }
+    }
+    cell->event = filtered;
+    atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+
+#ifdef TSDL_MOCK
+    mock_wakeEvents();
+#else
+    tsdl_wakeEvents();
+#endif
+
+    return TSDL_TRUE;
+}
+int poll_posted_event(Event event)
+{
+    posted_cell *cell = &posted.cells[posted.tail & (POSTED_EVENTS - 1)];
+    if (atomic_load_explicit(&cell->seq, memory_order_acquire) != posted.tail + 1)
+        return TSDL_FALSE;
+
+    *event = cell->event;
+    atomic_store_explicit(&cell->seq, posted.tail + POSTED_EVENTS, memory_order_release);
+    posted.tail++;
+
+    return TSDL_TRUE;
+}
+void clear_posted_events(void)
+{
+    TSDL_Event event;
+    while (poll_posted_event(&event))
+        ;
+}
+/* Drop payloads stay valid until the next poll/wait, then are released in one free */
+static long long now_ms(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+static int poll_backend(Event event)
+{
+#ifdef TSDL_MOCK
+    return mock_pollEvent(event) || joystick_poll(event);
+#else
+    return tsdl_pollEvent(event) || joystick_poll(event);
+#endif
+}
+static int wait_backend(Event event, int timeout)
+{
+    // joystick input doesn't wake the backend, so wait in slices and look in between
+    long long deadline = timeout >= 0 ? now_ms() + timeout : -1;
+    for (;;)
+    {
+        if (joystick_poll(event))
+            return TSDL_TRUE;
+        int slice = timeout;
+        if (joystick_active())
+        {
+            long long remaining = deadline >= 0 ? deadline - now_ms() : JOY_WAIT_SLICE;
+            slice = remaining < JOY_WAIT_SLICE ? (int)(remaining > 0 ? remaining : 0) : JOY_WAIT_SLICE;
+        }
+#ifdef TSDL_MOCK
+        int received = mock_waitEvent(event, slice);
+#else
+        int received = tsdl_waitEvent(event, slice);
+#endif
+        if (received || !joystick_active() || (deadline >= 0 && now_ms() >= deadline))
+            return received || joystick_poll(event);
+    }
+}
+/* Live events while replaying: quit, display and user events get through, input is dropped */
+static int live_event(Event event, Event live)
+{
+    if (live->type == TSDL_EVENT_QUIT || live->type >= TSDL_EVENT_USER || display_event(live->type))
+    {
+        *event = *live;
+        return TSDL_TRUE;
+    }
+    clear_drop_paths(live);
+
+    return TSDL_FALSE;
+}
+static int poll_replay(Event event)
+{
+    TSDL_Event live;
+    while (poll_backend(&live))
+    {
+        if (live_event(event, &live))
+            return TSDL_TRUE;
+    }
+
+    return replay_next(event);
+}
+static int deliver_event(Event event, int received)
+{
+    clear_drop_paths(&delivered_drop);
+    if (received)
+    {
+        record_event(event);
+        if (event->type == TSDL_EVENT_DROP)
+            delivered_drop = *event;
+    }
+
+    return received;
+}
+static int poll_event(Event event)
+{
+    if (replay_active())
+        return deliver_event(event, poll_replay(event));
+
+    return deliver_event(event, poll_backend(event));
+}
+static int wait_event(Event event, int timeout)
+{
+    long long deadline = timeout >= 0 ? now_ms() + timeout : -1;
+    while (replay_active())
+    {
+        if (poll_replay(event))
+            return deliver_event(event, TSDL_TRUE);
+
+        // sleep in the backend until the next record is due, so live events still wake us
+        int wait = replay_wait_ms();
+        if (deadline >= 0)
+        {
+            long long remaining = deadline - now_ms();
+            if (remaining <= 0)
+                return deliver_event(event, TSDL_FALSE);
+            if (remaining < wait)
+                wait = (int)remaining;
+        }
+        TSDL_Event live;
+        if (wait > 0 && wait_backend(&live, wait) && live_event(event, &live))
+            return deliver_event(event, TSDL_TRUE);
+    }
+    if (deadline >= 0)
+    {
+        long long remaining = deadline - now_ms();
+        timeout = remaining > 0 ? (int)remaining : 0;
+    }
+
+    return deliver_event(event, wait_backend(event, timeout));
+}
+static int init(int flags)
+{
+    int err = TSDL_ERR_NONE;
+    if (flags & TSDL_INIT_VIDEO)
+    {
+#ifdef TSDL_MOCK
+        err = mock_init_video();
+#else
+        err = tsdl_init_video();
+#endif
+    }
+    if (err == TSDL_ERR_NONE && (flags & TSDL_INIT_JOYSTICK))
+    {
+#if defined(TSDL_MOCK)
+        err = joystick_init(NULL); // evdev (or stand-ins) only
+#elif defined(TSDL_BACKEND_X11)
+        err = joystick_init(NULL); // Xlib has no joystick API; without evdev there is no source
+#else
+        err = joystick_init(tsdl_getJoystickFallback);
+#endif
+    }
+
+    return err;
+}
+static void quit(void)
+{
+    // an unfinished log is only trimmed when recording stops
+    record_events(NULL);
+    replay_events(NULL, 0);
+    // the last polled drop is otherwise only freed by the next poll
+    clear_drop_paths(&delivered_drop);
+    joystick_quit();
+    display_quit();
+#ifdef TSDL_MOCK
+    mock_quit();
+#else
+    tsdl_quit();
+#endif
+}
+static int event_state(TSDL_EventType type, int state)
+{
+    if (type <= TSDL_EVENT_NONE || type >= 32)
+    {
+        log_error(TSDL_ERR, "Event state only applies to built-in event types");
+        return TSDL_FALSE;
+    }
+
+    int enabled = event_enabled(type);
+    if (state == TSDL_QUERY || !state == !enabled)
+        return enabled;
+
+    if (state)
+        disabled_events &= ~(1u << type);
+    else
+        disabled_events |= 1u << type;
+#ifdef TSDL_MOCK
+    mock_updateEventMask();
+#else
+    tsdl_updateEventMask();
+#endif
+
+    return enabled;
+}
+static void set_event_filter(TSDL_EventFilter filter, object user)
+{
+    event_filter.fn = filter;
+    event_filter.user = user;
+}
+static int add_event_watch(TSDL_EventFilter watch, object user)
+{
+    if (!watch)
+        return log_error(TSDL_ERR, "Attempt to add null event watch");
+    if (watch_count >= TSDL_MAX_EVENT_WATCHES)
+        return log_error(TSDL_ERR, "Too many event watches");
+
+    event_watches[watch_count].fn = watch;
+    event_watches[watch_count].user = user;
+    watch_count++;
+
+    return TSDL_ERR_NONE;
+}
+static void remove_event_watch(TSDL_EventFilter watch, object user)
+{
+    for (int i = 0; i < watch_count; i++)
+    {
+        if (event_watches[i].fn == watch && event_watches[i].user == user)
+        {
+            memmove(&event_watches[i], &event_watches[i + 1], sizeof(event_hook) * (watch_count - i - 1));
+            watch_count--;
+            return;
+        }
+    }
+}
 
 static IWindow window_impl;
 static ITinySDL tinysdl_impl;
@@ -125,12 +825,28 @@ static void assign_implementation(void)
     window_impl.destroy = mock_destroy;
     window_impl.toggleFullscreen = mock_toggleFullscreen;
     window_impl.getGLContext = mock_getGLContext;
+    window_impl.setRelativeMouse = mock_setRelativeMouse;
+    window_impl.isVisible = mock_isVisible;
+    window_impl.getDisplay = mock_getDisplay;
 
     tinysdl_impl.window = &window_impl;
-    tinysdl_impl.init = mock_init;
-    tinysdl_impl.quit = mock_quit;
-    tinysdl_impl.getError = mock_getError;
-    tinysdl_impl.pollEvent = mock_pollEvent;
+    tinysdl_impl.init_video = mock_init_video;
+    tinysdl_impl.init = init;
+    tinysdl_impl.quit = quit;
+    tinysdl_impl.getJoystickState = joystick_state;
+    tinysdl_impl.getDisplay = display_state;
+    tinysdl_impl.recordEvents = record_events;
+    tinysdl_impl.replayEvents = replay_events;
+    tinysdl_impl.getError = get_error;
+    tinysdl_impl.lastError = last_error;
+    tinysdl_impl.clearError = clear_error;
+    tinysdl_impl.pollEvent = poll_event;
+    tinysdl_impl.waitEvent = wait_event;
+    tinysdl_impl.pushEvent = post_event;
+    tinysdl_impl.eventState = event_state;
+    tinysdl_impl.setEventFilter = set_event_filter;
+    tinysdl_impl.addEventWatch = add_event_watch;
+    tinysdl_impl.removeEventWatch = remove_event_watch;
     tinysdl_impl.getVersion = mock_getVersion;
 #else
     window_impl.create = window_create;
@@ -138,12 +854,28 @@ static void assign_implementation(void)
     window_impl.destroy = window_destroy;
     window_impl.toggleFullscreen = window_toggleFullscreen;
     window_impl.getGLContext = window_getGLContext;
+    window_impl.setRelativeMouse = window_setRelativeMouse;
+    window_impl.isVisible = window_isVisible;
+    window_impl.getDisplay = window_getDisplay;
 
     tinysdl_impl.window = &window_impl;
     tinysdl_impl.init_video = tsdl_init_video;
-    tinysdl_impl.quit = tsdl_quit;
-    tinysdl_impl.getError = tsdl_getError;
-    tinysdl_impl.pollEvent = tsdl_pollEvent;
+    tinysdl_impl.init = init;
+    tinysdl_impl.quit = quit;
+    tinysdl_impl.getJoystickState = joystick_state;
+    tinysdl_impl.getDisplay = display_state;
+    tinysdl_impl.recordEvents = record_events;
+    tinysdl_impl.replayEvents = replay_events;
+    tinysdl_impl.getError = get_error;
+    tinysdl_impl.lastError = last_error;
+    tinysdl_impl.clearError = clear_error;
+    tinysdl_impl.pollEvent = poll_event;
+    tinysdl_impl.waitEvent = wait_event;
+    tinysdl_impl.pushEvent = post_event;
+    tinysdl_impl.eventState = event_state;
+    tinysdl_impl.setEventFilter = set_event_filter;
+    tinysdl_impl.addEventWatch = add_event_watch;
+    tinysdl_impl.removeEventWatch = remove_event_watch;
     tinysdl_impl.getVersion = tsdl_getVersion;
 #endif
 }
@@ -152,9 +884,21 @@ ITinySDL TinySDL =
     {
         .window = &window_impl,
         .init_video = NULL,
+        .init = NULL,
         .quit = NULL,
         .pollEvent = NULL,
+        .waitEvent = NULL,
+        .pushEvent = NULL,
+        .eventState = NULL,
+        .setEventFilter = NULL,
+        .addEventWatch = NULL,
+        .removeEventWatch = NULL,
+        .getJoystickState = NULL,
+        .recordEvents = NULL,
+        .replayEvents = NULL,
         .getError = NULL,
+        .lastError = NULL,
+        .clearError = NULL,
         .getVersion = NULL,
 };
 
@@ -168,5 +912,13 @@ __attribute__((constructor)) static void tinysdl_init_constructor(void)
 {
     // Initialize the TinySDL interface
     assign_implementation();
+    for (size_t i = 0; i < POSTED_EVENTS; i++)
+    {
+        atomic_init(&posted.cells[i].seq, i);
+    }
+    for (size_t i = 0; i < LOG_LINES; i++)
+    {
+        atomic_init(&sink.cells[i].seq, i);
+    }
     *(ITinySDL *)&TinySDL = tinysdl_impl;
 }
\ No newline at end of file
@@ -1,7 +1,7 @@
 // src/tinysdl_core.h
 #include "tinysdl_core.h"
+#include "internal/tsdl_gl.h"
 #include <GLFW/glfw3.h>
-#include <GL/gl.h>
 #include <stdio.h>
 #include <string.h>
 //  internal
@@ -16,25 +16,20 @@
 
 struct tinysdl_window_s
 {
-   GLFWwindow *glfw_window; // GLFW window handle
-   int w;                   // Window width
-   int h;                   // Window height
-   int is_fullscreen;       // Fullscreen flag
-   int close_requested;     // Close requested flag
-   struct
-   {
-      int w; // Restore to width
-      int h; // Restore to height
-      int x; // Restore to x position
-      int y; // Restore to y position
-   } resto;
+   GLFWwindow *glfw_window;  // GLFW window handle
+   TSDL_WindowTracker track; // State and geometry, driven by the window callbacks
+   int exclusive;            // Fullscreen takes over the monitor (video mode) instead of covering it
+   int close_requested;      // Close requested flag
+   int relative;             // Relative mouse mode
+   double last_x, last_y;    // Last (unbounded) cursor position in relative mode
+   double rel_dx, rel_dy;    // Relative motion accumulated since the last pump
 };
 
 static GLFWwindow *shared_context = NULL;
 static window active_window = NULL;
-static int is_initialized = 0; // Initialization flag
-static queue ev_queue = NULL;  // Event queue
-static int in_fs_toggle = 0;   // Flag to prevent recursive fullscreen toggle
+static int is_initialized = 0;  // Initialization flag
+static queue ev_queue = NULL;   // Event queue
+static TSDL_Event pending_text; // Characters batched since the last non-key event
 
 // GLFW Callback Declarations =================================================
 static void glfw_error_callback(int, const char *);
@@ -49,9 +44,18 @@ static void glfw_drop_callback(GLFWwindow *, int, const char **);
 static void glfw_mouse_button_callback(GLFWwindow *, int, int, int);
 static void glfw_cursor_pos_callback(GLFWwindow *, double, double);
 static void glfw_mouse_wheel_callback(GLFWwindow *, double, double);
+static void glfw_char_callback(GLFWwindow *, unsigned int);
+static void glfw_monitor_callback(GLFWmonitor *, int);
 
 // TSDL (OpenGL) Functions =============================================================
 static TSDL_Keycode map_keys(int);
+static void make_current(GLFWwindow *);
+static void queue_event(Event);
+static void flush_text(void);
+static void apply_event_mask(GLFWwindow *);
+static int window_mods(GLFWwindow *, int);
+static GLFWmonitor *monitor_at(int, int);
+static void refresh_displays(void);
 
 int tsdl_init_video(void)
 {
@@ -72,7 +76,7 @@ int tsdl_init_video(void)
       glfwTerminate();
       return log_error(TSDL_ERR_GL, "Failed to create shared context");
    }
-   glfwMakeContextCurrent(shared_context);
+   make_current(shared_context);
 
    // Set GLFW window hints
    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -92,9 +96,13 @@ int tsdl_init_video(void)
       return log_error(TSDL_ERR_INIT, "Failed to create event queue");
    }
 
+   // the starting layout; hot-plugs re-enumerate from the callback
+   glfwSetMonitorCallback(glfw_monitor_callback);
+   refresh_displays();
+
    is_initialized = TSDL_TRUE;
    // [TODO] Task: replace "OpenGL" with define for backend
-   LOG_STAT("Initialized Backend (%s): flags=%d", TSDL_BACKEND, TSDL_INIT_VIDEO);
+   LOG_INFO("Initialized Backend (%s): flags=%d", TSDL_BACKEND, TSDL_INIT_VIDEO);
 
    return TSDL_ERR_NONE;
 }
@@ -119,6 +127,7 @@ void tsdl_quit(void)
    // free the event queue
    Queue.free(ev_queue);
    ev_queue = NULL;
+   pending_text.type = TSDL_EVENT_NONE;
    // free the active window & shared context
    if (active_window)
    {
@@ -132,13 +141,10 @@ void tsdl_quit(void)
    }
    // Terminate GLFW
    glfwTerminate();
+   clear_posted_events();
    is_initialized = TSDL_FALSE;
 
-   LOG_STAT("Quit %s Backend", TSDL_BACKEND);
-}
-const string tsdl_getError(void)
-{
-   return err_trace;
+   LOG_INFO("Quit %s Backend", TSDL_BACKEND);
 }
 int tsdl_pollEvent(Event event)
 {
@@ -149,6 +155,16 @@ int tsdl_pollEvent(Event event)
    }
 
    glfwPollEvents();
+   flush_text();
+   if (active_window && (active_window->rel_dx != 0 || active_window->rel_dy != 0))
+   {
+      // one relative event per pump, however many raw samples arrived
+      TSDL_Event ev = {.type = TSDL_EVENT_MOUSE_RELATIVE};
+      ev.data.mouse_relative.dx = active_window->rel_dx;
+      ev.data.mouse_relative.dy = active_window->rel_dy;
+      active_window->rel_dx = active_window->rel_dy = 0;
+      queue_event(&ev);
+   }
    Event queued_ev = (Event)Queue.dequeue(ev_queue);
    if (queued_ev)
    {
@@ -162,16 +178,73 @@ int tsdl_pollEvent(Event event)
    {
       event->type = TSDL_EVENT_QUIT;
       active_window->close_requested = 1;
+      if (dispatch_event(event))
+         return TSDL_TRUE;
+   }
 
-      return TSDL_TRUE;
+   return poll_posted_event(event);
+}
+int tsdl_waitEvent(Event event, int timeout)
+{
+   if (!is_initialized)
+   {
+      log_error(TSDL_ERR_INIT, "TinySDL is not initialized");
+      return TSDL_FALSE;
+   }
+
+   double deadline = glfwGetTime() + timeout / 1000.0;
+   while (!tsdl_pollEvent(event))
+   {
+      // posting wakes this with glfwPostEmptyEvent
+      if (timeout < 0)
+      {
+         glfwWaitEvents();
+         continue;
+      }
+      double remaining = deadline - glfwGetTime();
+      if (remaining <= 0)
+         return TSDL_FALSE;
+      glfwWaitEventsTimeout(remaining);
    }
 
-   return TSDL_FALSE;
+   return TSDL_TRUE;
+}
+void tsdl_wakeEvents(void)
+{
+   if (is_initialized)
+      glfwPostEmptyEvent();
+}
+void tsdl_updateEventMask(void)
+{
+   if (active_window)
+      apply_event_mask(active_window->glfw_window);
 }
 const string tsdl_getVersion(void)
 {
    return TSDL_VER;
 }
+int tsdl_getJoystickFallback(int index, TSDL_JoystickState *state)
+{
+   int jid = GLFW_JOYSTICK_1 + index;
+   if (!is_initialized || jid > GLFW_JOYSTICK_LAST || !glfwJoystickPresent(jid))
+      return TSDL_FALSE;
+
+   int count = 0;
+   const float *axes = glfwGetJoystickAxes(jid, &count);
+   state->axis_count = count < TSDL_JOY_MAX_AXES ? count : TSDL_JOY_MAX_AXES;
+   for (int i = 0; axes && i < state->axis_count; i++)
+      state->axes[i] = axes[i];
+
+   const unsigned char *buttons = glfwGetJoystickButtons(jid, &count);
+   state->button_count = count < TSDL_JOY_MAX_BUTTONS ? count : TSDL_JOY_MAX_BUTTONS;
+   for (int i = 0; buttons && i < state->button_count; i++)
+      state->buttons |= (buttons[i] == GLFW_PRESS) ? 1u << i : 0;
+
+   const char *name = glfwGetJoystickName(jid);
+   snprintf(state->name, sizeof(state->name), "%s", name ? name : "Joystick");
+
+   return TSDL_TRUE;
+}
 
 // Window Functions ===========================================================
 window window_create(string title, int x, int y, int w, int h, int flags)
@@ -188,11 +261,29 @@ window window_create(string title, int x, int y, int w, int h, int flags)
    GLFWwindow *glfw_win = NULL;
    if (flags & TSDL_WINDOW_FULLSCREEN)
    {
-      GLFWmonitor *monitor = glfwGetPrimaryMonitor();
-      const GLFWvidmode *mode = glfwGetVideoMode(monitor);
-      glfw_win = glfwCreateWindow(mode->width, mode->height, title, monitor, shared_context);
-      w = mode->width;
-      h = mode->height;
+      // the requested position picks the monitor
+      GLFWmonitor *monitor = monitor_at(x, y);
+      const GLFWvidmode *mode = monitor ? glfwGetVideoMode(monitor) : NULL;
+      if (!mode)
+      {
+         log_error(TSDL_ERR_WINDOW, "No monitor available for a fullscreen window");
+         return NULL;
+      }
+      if (flags & TSDL_WINDOW_EXCLUSIVE)
+      {
+         glfw_win = glfwCreateWindow(mode->width, mode->height, title, monitor, shared_context);
+      }
+      else
+      {
+         // borderless: an undecorated window over the monitor, in its current mode
+         int mx, my;
+         glfwGetMonitorPos(monitor, &mx, &my);
+         glfwWindowHint(GLFW_DECORATED, GLFW_FALSE);
+         glfw_win = glfwCreateWindow(mode->width, mode->height, title, NULL, shared_context);
+         glfwWindowHint(GLFW_DECORATED, GLFW_TRUE);
+         if (glfw_win)
+            glfwSetWindowPos(glfw_win, mx, my);
+      }
    }
    else
    {
@@ -210,10 +301,19 @@ window window_create(string title, int x, int y, int w, int h, int flags)
    {
       if (flags & TSDL_WINDOW_CENTERED)
       {
-         GLFWmonitor *monitor = glfwGetPrimaryMonitor();
-         const GLFWvidmode *mode = glfwGetVideoMode(monitor);
-         x = (mode->width - w) / 2;
-         y = (mode->height - h) / 2;
+         // centred on the monitor under the requested position
+         int mx, my;
+         GLFWmonitor *monitor = monitor_at(x, y);
+         const GLFWvidmode *mode = monitor ? glfwGetVideoMode(monitor) : NULL;
+         if (!mode)
+         {
+            glfwDestroyWindow(glfw_win);
+            log_error(TSDL_ERR_WINDOW, "No monitor available to centre the window on");
+            return NULL;
+         }
+         glfwGetMonitorPos(monitor, &mx, &my);
+         x = mx + (mode->width - w) / 2;
+         y = my + (mode->height - h) / 2;
          glfwSetWindowPos(glfw_win, x, y);
       }
       else
@@ -231,30 +331,23 @@ window window_create(string title, int x, int y, int w, int h, int flags)
    }
 
    win->glfw_window = glfw_win;
-   win->w = w;
-   win->h = h;
-   win->is_fullscreen = (flags & TSDL_WINDOW_FULLSCREEN) ? TSDL_TRUE : TSDL_FALSE;
+   win->exclusive = (flags & TSDL_WINDOW_EXCLUSIVE) ? TSDL_TRUE : TSDL_FALSE;
    win->close_requested = 0;
-   win->resto.w = w;
-   win->resto.h = h;
-   win->resto.x = x;
-   win->resto.y = y;
+   win->relative = TSDL_FALSE;
+   win->rel_dx = win->rel_dy = 0;
+   // the requested geometry is the restore target, even when created fullscreen
+   track_init(&win->track, x, y, w, h, flags);
+   glfwGetWindowSize(glfw_win, &win->track.w, &win->track.h);
 
-   // set glfw callbacks
+   // set glfw callbacks; the window state ones always run, they drive the tracker
    glfwSetWindowUserPointer(glfw_win, win);
-   glfwSetKeyCallback(glfw_win, glfw_key_callback);
    glfwSetWindowSizeCallback(glfw_win, glfw_window_size_callback);
    glfwSetWindowPosCallback(glfw_win, glfw_window_pos_callback);
    glfwSetWindowIconifyCallback(glfw_win, glfw_iconify_callback);
    glfwSetWindowMaximizeCallback(glfw_win, glfw_maximize_callback);
-   glfwSetWindowFocusCallback(glfw_win, glfw_focus_callback);
-   glfwSetWindowRefreshCallback(glfw_win, glfw_window_refresh_callback);
-   glfwSetDropCallback(glfw_win, glfw_drop_callback);
-   glfwSetMouseButtonCallback(glfw_win, glfw_mouse_button_callback);
-   glfwSetCursorPosCallback(glfw_win, glfw_cursor_pos_callback);
-   glfwSetScrollCallback(glfw_win, glfw_mouse_wheel_callback);
-
-   glfwMakeContextCurrent(glfw_win);
+   apply_event_mask(glfw_win);
+
+   make_current(glfw_win);
    glfwSwapInterval(1); // Enable V-Sync
 
    active_window = win;
@@ -268,8 +361,6 @@ void window_close(window win)
    if (!win || !win->glfw_window)
    {
       log_error(TSDL_ERR_WINDOW, "Invalid window handle");
-      LOG_STAT(tsdl_getError());
-
       return;
    }
 
@@ -281,11 +372,11 @@ void window_destroy(window win)
    if (!win || !win->glfw_window)
    {
       log_error(TSDL_ERR_WINDOW, "Invalid window handle");
-      LOG_STAT(tsdl_getError());
-
       return;
    }
 
+   tsdl_stopRenderThread(win);
+   tsdl_endCapture(win);
    glfwDestroyWindow(win->glfw_window);
    Mem.free(win);
    LOG_STAT("Window destroyed");
@@ -295,252 +386,425 @@ void window_toggleFullscreen(window win)
    if (!win || !win->glfw_window)
    {
       log_error(TSDL_ERR_WINDOW, "Attempt to toggle full screen on invalid (NULL) window handle");
-      LOG_STAT(tsdl_getError());
-
       return;
    }
 
    LOG_STAT("Toggling fullscreen");
-   in_fs_toggle = 1; // set toggling flag
-
-   // Store current GL state
-   glfwMakeContextCurrent(win->glfw_window);
-   GLint viewport[4];
-   glGetIntegerv(GL_VIEWPORT, viewport);
-   GLfloat clear_color[4];
-   glGetFloatv(GL_COLOR_CLEAR_VALUE, clear_color);
 
-   if (win->is_fullscreen)
+   // the target monitor is resolved before any state changes, so a missing one leaves the window as it was
+   TSDL_WindowTracker *track = &win->track;
+   GLFWmonitor *monitor = NULL;
+   const GLFWvidmode *mode = NULL;
+   if (!track->fullscreen)
    {
-      // Exit fullscreen: restore to original size and position
-      glfwSetWindowMonitor(win->glfw_window, NULL, win->resto.x, win->resto.y, win->resto.w, win->resto.h, 0);
-      glfwSetWindowSize(win->glfw_window, win->resto.w, win->resto.h); // Explicitly set size
-      glfwSetWindowPos(win->glfw_window, win->resto.x, win->resto.y);  // Explicitly set position
-      win->is_fullscreen = 0;
+      monitor = monitor_at(track->x + track->w / 2, track->y + track->h / 2);
+      mode = monitor ? glfwGetVideoMode(monitor) : NULL;
+      if (!mode)
+      {
+         log_error(TSDL_ERR_WINDOW, "No monitor available to go fullscreen on");
+         return;
+      }
+   }
+
+   // the state changes first, so the size/pos callbacks it triggers leave the restore target alone
+   TSDL_Event ev = {0};
+   track->fullscreen = !track->fullscreen;
+   if (track_state(track, &ev))
+      queue_event(&ev);
 
-      // Ensure it’s not maximized
-      glfwRestoreWindow(win->glfw_window);
+   // one glfwSetWindowMonitor either way; GL state lives in the context, which it keeps, and
+   // the viewport follows the RESIZED event instead of being reset here
+   GLFWwindow *glfw_window = win->glfw_window;
+   if (!track->fullscreen)
+   {
+      if (!win->exclusive)
+         glfwSetWindowAttrib(glfw_window, GLFW_DECORATED, GLFW_TRUE);
+      glfwSetWindowMonitor(glfw_window, NULL, track->normal.x, track->normal.y, track->normal.w, track->normal.h, GLFW_DONT_CARE);
    }
    else
    {
-      // Enter fullscreen: save current state
-      glfwGetWindowPos(win->glfw_window, &win->resto.x, &win->resto.y);
-      glfwGetWindowSize(win->glfw_window, &win->resto.w, &win->resto.h);
-      GLFWmonitor *monitor = glfwGetPrimaryMonitor();
-      const GLFWvidmode *mode = glfwGetVideoMode(monitor);
-      glfwSetWindowMonitor(win->glfw_window, monitor, 0, 0, mode->width, mode->height, mode->refreshRate);
-      win->is_fullscreen = 1;
+      if (win->exclusive)
+      {
+         glfwSetWindowMonitor(glfw_window, monitor, 0, 0, mode->width, mode->height, mode->refreshRate);
+      }
+      else
+      {
+         // borderless: cover the monitor in its current mode, so nothing is re-modeset
+         int mx, my;
+         glfwGetMonitorPos(monitor, &mx, &my);
+         glfwSetWindowAttrib(glfw_window, GLFW_DECORATED, GLFW_FALSE);
+         glfwSetWindowMonitor(glfw_window, NULL, mx, my, mode->width, mode->height, GLFW_DONT_CARE);
+      }
    }
 
-   // Restore GL state
-   glfwMakeContextCurrent(win->glfw_window);
-   glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
-   glClearColor(clear_color[0], clear_color[1], clear_color[2], clear_color[3]);
-   glfwSwapInterval(1);
-
-   in_fs_toggle = 0; // reset toggling flag
-
-   LOG_STAT("Fullscreen mode=%d", win->is_fullscreen);
+   LOG_STAT("Fullscreen mode=%d", win->track.fullscreen);
 }
 object window_getGLContext(window win)
 {
    if (!win || !win->glfw_window)
    {
       log_error(TSDL_ERR_WINDOW, "Attempt to obtain GL context from invalid (NULL) window handle");
-      LOG_STAT(tsdl_getError());
-
       return NULL;
    }
 
-   glfwMakeContextCurrent(win->glfw_window);
+   if (!render_thread_owns(win))
+      make_current(win->glfw_window);
    return win->glfw_window;
 }
+int window_setRelativeMouse(window win, int enabled)
+{
+   if (!win || !win->glfw_window)
+      return log_error(TSDL_ERR_WINDOW, "Attempt to set relative mouse on invalid (NULL) window handle");
+
+   GLFWwindow *glfw_window = win->glfw_window;
+   if (enabled)
+   {
+      // a disabled cursor is hidden, locked and reports unbounded virtual positions
+      glfwSetInputMode(glfw_window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+      if (glfwRawMouseMotionSupported())
+         glfwSetInputMode(glfw_window, GLFW_RAW_MOUSE_MOTION, GLFW_TRUE);
+      glfwGetCursorPos(glfw_window, &win->last_x, &win->last_y);
+   }
+   else
+   {
+      if (glfwRawMouseMotionSupported())
+         glfwSetInputMode(glfw_window, GLFW_RAW_MOUSE_MOTION, GLFW_FALSE);
+      glfwSetInputMode(glfw_window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+   }
+   win->relative = enabled ? TSDL_TRUE : TSDL_FALSE;
+   win->rel_dx = win->rel_dy = 0;
+   apply_event_mask(glfw_window);
+
+   LOG_STAT("Relative mouse=%d", win->relative);
+
+   return TSDL_ERR_NONE;
+}
+int window_isVisible(window win)
+{
+   if (!win || !win->glfw_window)
+      return TSDL_FALSE;
+   return track_visible(&win->track);
+}
+int window_getDisplay(window win)
+{
+   if (!win || !win->glfw_window)
+      return -1;
+   return display_at(win->track.x + win->track.w / 2, win->track.y + win->track.h / 2);
+}
 
 // GLFW Callbacks =============================================================
 static void glfw_error_callback(int error, const char *description)
 {
-   LOG_STAT("[GLFW] [Error=%d] %s", error, description);
-   log_error(TSDL_ERR_GL, logBuffer);
+   // description is only valid during the callback, so the record keeps a message per code
+   LOG_WARN("[GLFW] [Error=%d] %s", error, description);
+   switch (error)
+   {
+   case GLFW_NOT_INITIALIZED:
+      log_error(TSDL_ERR_GL, "GLFW: not initialized");
+      break;
+   case GLFW_NO_CURRENT_CONTEXT:
+      log_error(TSDL_ERR_GL, "GLFW: no current context");
+      break;
+   case GLFW_INVALID_ENUM:
+      log_error(TSDL_ERR_GL, "GLFW: invalid enum");
+      break;
+   case GLFW_INVALID_VALUE:
+      log_error(TSDL_ERR_GL, "GLFW: invalid value");
+      break;
+   case GLFW_OUT_OF_MEMORY:
+      log_error(TSDL_ERR_GL, "GLFW: out of memory");
+      break;
+   case GLFW_API_UNAVAILABLE:
+      log_error(TSDL_ERR_GL, "GLFW: API unavailable");
+      break;
+   case GLFW_VERSION_UNAVAILABLE:
+      log_error(TSDL_ERR_GL, "GLFW: OpenGL version unavailable");
+      break;
+   case GLFW_PLATFORM_ERROR:
+      log_error(TSDL_ERR_GL, "GLFW: platform error");
+      break;
+   case GLFW_FORMAT_UNAVAILABLE:
+      log_error(TSDL_ERR_GL, "GLFW: format unavailable");
+      break;
+   case GLFW_NO_WINDOW_CONTEXT:
+      log_error(TSDL_ERR_GL, "GLFW: window has no context");
+      break;
+   default:
+      log_error(TSDL_ERR_GL, "GLFW reported an error");
+      break;
+   }
 }
 static void glfw_key_callback(GLFWwindow *glfw_window, int key, int scancode, int action, int mods)
 {
    if (key == GLFW_KEY_UNKNOWN)
       return;
 
-   Event ev = NULL;
+   TSDL_Event ev = {0};
    TSDL_Keycode mapped_key;
 
    switch (action)
    {
    case GLFW_PRESS:
    case GLFW_REPEAT:
-      if (!(ev = create_event(TSDL_EVENT_KEY_DOWN)))
-         return;
-      ev->data.key.keycode = mapped_key = map_keys(key);
-      ev->data.key.repeat = (action == GLFW_REPEAT) ? 1 : 0;
-      ev->data.key.mods = map_key_mods(mods);
+      ev.type = TSDL_EVENT_KEY_DOWN;
+      ev.data.key.keycode = mapped_key = map_keys(key);
+      ev.data.key.repeat = (action == GLFW_REPEAT) ? 1 : 0;
+      ev.data.key.mods = window_mods(glfw_window, mods);
 
       break;
    case GLFW_RELEASE:
-      if (!(ev = create_event(TSDL_EVENT_KEY_UP)))
-         return;
-      ev->data.key.keycode = mapped_key = map_keys(key);
-      ev->data.key.repeat = 0;
-      ev->data.key.mods = map_key_mods(mods);
+      ev.type = TSDL_EVENT_KEY_UP;
+      ev.data.key.keycode = mapped_key = map_keys(key);
+      ev.data.key.repeat = 0;
+      ev.data.key.mods = window_mods(glfw_window, mods);
 
       break;
    default:
-      LOG_STAT("Unknown key action");
+      LOG_TRACE("Unknown key action");
       return; // Ignore unknown actions
    }
-   Queue.enqueue(ev_queue, ev);
+   queue_event(&ev);
 
    // Debug logging to verify key mapping
-   LOG_STAT("Key event: GLFW=%d, TSDL=%d, action=%d", key, mapped_key, action);
+   LOG_TRACE("Key event: GLFW=%d, TSDL=%d, action=%d", key, mapped_key, action);
 }
 static void glfw_window_size_callback(GLFWwindow *glfw_window, int w, int h)
 {
    window win = (window)glfwGetWindowUserPointer(glfw_window);
-   if (win)
-   {
-      if (!win->is_fullscreen)
-      {
-         win->w = w;
-         win->h = h;
-         if (!in_fs_toggle)
-         {
-            win->resto.w = w;
-            win->resto.h = h;
-         }
-      }
-   }
-   Event ev = create_event(TSDL_EVENT_WINDOW_RESIZED);
-   if (!ev)
-      return;
-   ev->data.window_resized.w = w;
-   ev->data.window_resized.h = h;
-   ev->data.window_resized.is_fullscreen = win ? win->is_fullscreen : 0;
-   Queue.enqueue(ev_queue, ev);
+   TSDL_Event ev = {0};
+   if (win && track_geometry(&win->track, win->track.x, win->track.y, w, h, &ev))
+      queue_event(&ev);
 }
 static void glfw_iconify_callback(GLFWwindow *glfw_window, int iconified)
 {
-   Event ev = create_event(iconified ? TSDL_EVENT_WINDOW_MINIMIZED : TSDL_EVENT_WINDOW_RESTORED);
-   if (!ev)
+   window win = (window)glfwGetWindowUserPointer(glfw_window);
+   TSDL_Event ev = {0};
+   LOG_TRACE(iconified ? "Iconify: Minimized" : "Iconify: Restored"); // Debug log
+   if (!win)
       return;
-   LOG_STAT(iconified ? "Iconify: Minimized" : "Iconify: Restored"); // Debug log
-   Queue.enqueue(ev_queue, ev);
+   win->track.minimized = iconified;
+   if (track_state(&win->track, &ev))
+      queue_event(&ev);
 }
 static void glfw_maximize_callback(GLFWwindow *glfw_window, int maximized)
 {
-   Event ev = create_event(maximized ? TSDL_EVENT_WINDOW_MAXIMIZED : TSDL_EVENT_WINDOW_RESTORED);
-   if (!ev)
+   window win = (window)glfwGetWindowUserPointer(glfw_window);
+   TSDL_Event ev = {0};
+   LOG_TRACE(maximized ? "Maximize: Maximized" : "Maximize: Restored"); // Debug log
+   if (!win)
       return;
-   LOG_STAT(maximized ? "Maximize: Maximized" : "Maximize: Restored"); // Debug log
-   Queue.enqueue(ev_queue, ev);
+   win->track.maximized = maximized;
+   if (track_state(&win->track, &ev))
+      queue_event(&ev);
 }
 static void glfw_focus_callback(GLFWwindow *glfw_window, int focused)
 {
-   Event ev = create_event(focused ? TSDL_EVENT_WINDOW_FOCUS_GAINED : TSDL_EVENT_WINDOW_FOCUS_LOST);
-   if (!ev)
-      return;
-   LOG_STAT(focused ? "Focus: Gained" : "Focus: Lost"); // Debug log
-   Queue.enqueue(ev_queue, ev);
+   TSDL_Event ev = {.type = focused ? TSDL_EVENT_WINDOW_FOCUS_GAINED : TSDL_EVENT_WINDOW_FOCUS_LOST};
+   LOG_TRACE(focused ? "Focus: Gained" : "Focus: Lost"); // Debug log
+   queue_event(&ev);
 }
 static void glfw_window_pos_callback(GLFWwindow *glfw_window, int x, int y)
 {
    window win = (window)glfwGetWindowUserPointer(glfw_window);
-   if (win && !win->is_fullscreen && !in_fs_toggle)
-   {
-      win->resto.x = x;
-      win->resto.y = y;
-
-      Event ev = create_event(TSDL_EVENT_WINDOW_MOVED);
-      if (!ev)
-         return;
-      ev->data.window_moved.x = x;
-      ev->data.window_moved.y = y;
-      Queue.enqueue(ev_queue, ev);
-   }
+   TSDL_Event ev = {0};
+   if (win && track_geometry(&win->track, x, y, win->track.w, win->track.h, &ev))
+      queue_event(&ev);
 }
 static void glfw_window_refresh_callback(GLFWwindow *glfw_window)
 {
-   Event ev = create_event(TSDL_EVENT_WINDOW_EXPOSED);
-   if (!ev)
-      return;
-   Queue.enqueue(ev_queue, ev);
+   TSDL_Event ev = {.type = TSDL_EVENT_WINDOW_EXPOSED};
+   queue_event(&ev);
 }
 static void glfw_drop_callback(GLFWwindow *glfw_window, int count, const char **paths)
 {
-   Event ev = create_event(TSDL_EVENT_DROP);
-   if (!ev)
+   TSDL_Event ev = {.type = TSDL_EVENT_DROP};
+   ev.data.drop.paths = copy_drop_paths(count, paths); // GLFW manages this memory, valid only during callback
+   ev.data.drop.count = count;
+   if (!ev.data.drop.paths)
       return;
-   ev->data.drop.paths = copy_drop_paths(count, paths); // GLFW manages this memory, valid only during callback
-   ev->data.drop.count = count;
-   Queue.enqueue(ev_queue, ev);
+   queue_event(&ev);
 }
 static void glfw_mouse_button_callback(GLFWwindow *glfw_window, int button, int action, int mods)
 {
-   Event ev = create_event(action == GLFW_PRESS ? TSDL_EVENT_MOUSE_BUTTON_DOWN : TSDL_EVENT_MOUSE_BUTTON_UP);
-   if (!ev)
-      return;
-   ev->data.mouse_button.button = button;
-   ev->data.mouse_button.mods = map_key_mods(mods);
-   Queue.enqueue(ev_queue, ev);
+   TSDL_Event ev = {.type = action == GLFW_PRESS ? TSDL_EVENT_MOUSE_BUTTON_DOWN : TSDL_EVENT_MOUSE_BUTTON_UP};
+   ev.data.mouse_button.button = button;
+   ev.data.mouse_button.mods = window_mods(glfw_window, mods);
+   queue_event(&ev);
 }
 static void glfw_cursor_pos_callback(GLFWwindow *glfw_window, double x, double y)
 {
-   Event ev = create_event(TSDL_EVENT_MOUSE_MOVED);
-   if (!ev)
+   window win = (window)glfwGetWindowUserPointer(glfw_window);
+   if (win && win->relative)
+   {
+      win->rel_dx += x - win->last_x;
+      win->rel_dy += y - win->last_y;
+      win->last_x = x;
+      win->last_y = y;
       return;
-   ev->data.mouse_moved.x = x;
-   ev->data.mouse_moved.y = y;
-   Queue.enqueue(ev_queue, ev);
+   }
+
+   TSDL_Event ev = {.type = TSDL_EVENT_MOUSE_MOVED};
+   ev.data.mouse_moved.x = x;
+   ev.data.mouse_moved.y = y;
+   queue_event(&ev);
 }
 static void glfw_mouse_wheel_callback(GLFWwindow *glfw_window, double xoffset, double yoffset)
 {
-   Event ev = create_event(TSDL_EVENT_MOUSE_WHEEL);
-   if (!ev)
-      return;
-   ev->data.mouse_wheel.xoffset = xoffset;
-   ev->data.mouse_wheel.yoffset = yoffset;
-   Queue.enqueue(ev_queue, ev);
+   TSDL_Event ev = {.type = TSDL_EVENT_MOUSE_WHEEL};
+   ev.data.mouse_wheel.xoffset = xoffset;
+   ev.data.mouse_wheel.yoffset = yoffset;
+   queue_event(&ev);
+}
+static void glfw_char_callback(GLFWwindow *glfw_window, unsigned int codepoint)
+{
+   char utf8[4];
+   int len = utf8_encode(codepoint, utf8);
+   if (len && !append_text(&pending_text, utf8, len))
+   {
+      // inline buffer full; queue it and start the next batch
+      flush_text();
+      append_text(&pending_text, utf8, len);
+   }
+}
+static void glfw_monitor_callback(GLFWmonitor *monitor, int change)
+{
+   refresh_displays();
 }
 
 // Specialized Helper Functions ===============================================
-int map_key_mods(int glfw_mods)
+/* Run the event filter and watches at capture time; only surviving events are allocated and queued */
+static void queue_event(Event ev)
 {
-   int mods = TSDL_MOD_NONE;
-   if (glfw_mods & GLFW_MOD_SHIFT)
+   // text batches across the key events that produce it; anything else delivers it first
+   if (ev->type != TSDL_EVENT_KEY_DOWN && ev->type != TSDL_EVENT_KEY_UP && ev->type != TSDL_EVENT_TEXT_INPUT)
+      flush_text();
+   if (!dispatch_event(ev))
+   {
+      clear_drop_paths(ev);
+      return;
+   }
+   Event queued = create_event(ev->type);
+   if (!queued)
    {
-      // GLFW_MOD_SHIFT is true if either shift is down; check specific keys
-      if (glfwGetKey(glfwGetCurrentContext(), GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
-         mods |= TSDL_MOD_LSHIFT;
-      if (glfwGetKey(glfwGetCurrentContext(), GLFW_KEY_RIGHT_SHIFT) == GLFW_PRESS)
-         mods |= TSDL_MOD_RSHIFT;
+      clear_drop_paths(ev);
+      return;
    }
-   if (glfw_mods & GLFW_MOD_CONTROL)
+   *queued = *ev;
+   Queue.enqueue(ev_queue, queued);
+}
+/* Queue the batched characters, if any */
+static void flush_text(void)
+{
+   if (pending_text.type != TSDL_EVENT_TEXT_INPUT)
+      return;
+   TSDL_Event ev = pending_text;
+   pending_text.type = TSDL_EVENT_NONE;
+   queue_event(&ev);
+}
+/* Monitor under a desktop point, or the primary one; NULL when no monitor is connected */
+static GLFWmonitor *monitor_at(int x, int y)
+{
+   int count;
+   GLFWmonitor **monitors = glfwGetMonitors(&count);
+   for (int i = 0; i < count; i++)
    {
-      if (glfwGetKey(glfwGetCurrentContext(), GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS)
-         mods |= TSDL_MOD_LCTRL;
-      if (glfwGetKey(glfwGetCurrentContext(), GLFW_KEY_RIGHT_CONTROL) == GLFW_PRESS)
-         mods |= TSDL_MOD_RCTRL;
+      int mx, my;
+      const GLFWvidmode *mode = glfwGetVideoMode(monitors[i]);
+      if (!mode)
+         continue;
+      glfwGetMonitorPos(monitors[i], &mx, &my);
+      if (x >= mx && y >= my && x < mx + mode->width && y < my + mode->height)
+         return monitors[i];
    }
-   if (glfw_mods & GLFW_MOD_ALT)
+
+   return glfwGetPrimaryMonitor();
+}
+/* Hand the current monitor list to the display subsystem */
+static void refresh_displays(void)
+{
+   int count, listed = 0;
+   GLFWmonitor **monitors = glfwGetMonitors(&count);
+   GLFWmonitor *primary = glfwGetPrimaryMonitor();
+   TSDL_DisplayInfo list[TSDL_MAX_DISPLAYS] = {0};
+   for (int i = 0; i < count && listed < TSDL_MAX_DISPLAYS; i++)
    {
-      if (glfwGetKey(glfwGetCurrentContext(), GLFW_KEY_LEFT_ALT) == GLFW_PRESS)
-         mods |= TSDL_MOD_LALT;
-      if (glfwGetKey(glfwGetCurrentContext(), GLFW_KEY_RIGHT_ALT) == GLFW_PRESS)
-         mods |= TSDL_MOD_RALT;
+      float sx, sy;
+      const GLFWvidmode *mode = glfwGetVideoMode(monitors[i]);
+      if (!mode)
+         continue; // disconnected while the list was being read
+      TSDL_DisplayInfo *info = &list[listed++];
+      glfwGetMonitorPos(monitors[i], &info->x, &info->y);
+      glfwGetMonitorContentScale(monitors[i], &sx, &sy);
+      info->w = mode->width;
+      info->h = mode->height;
+      info->refresh = mode->refreshRate; // whole Hz only
+      info->scale = sx;
+      info->primary = monitors[i] == primary;
+      // GLFW names are model names; two of a model are told apart by order
+      snprintf(info->name, sizeof(info->name), "%s", glfwGetMonitorName(monitors[i]));
    }
-   if (glfw_mods & GLFW_MOD_SUPER)
+
+   display_update(list, listed);
+}
+/* Register only the callbacks whose events are enabled, so GLFW never dispatches the rest */
+static void apply_event_mask(GLFWwindow *glfw_window)
+{
+   int key = event_enabled(TSDL_EVENT_KEY_DOWN) || event_enabled(TSDL_EVENT_KEY_UP);
+   int focus = event_enabled(TSDL_EVENT_WINDOW_FOCUS_GAINED) || event_enabled(TSDL_EVENT_WINDOW_FOCUS_LOST);
+   int button = event_enabled(TSDL_EVENT_MOUSE_BUTTON_DOWN) || event_enabled(TSDL_EVENT_MOUSE_BUTTON_UP);
+   window win = (window)glfwGetWindowUserPointer(glfw_window);
+   int motion = (win && win->relative) ? event_enabled(TSDL_EVENT_MOUSE_RELATIVE) : event_enabled(TSDL_EVENT_MOUSE_MOVED);
+
+   glfwSetKeyCallback(glfw_window, key ? glfw_key_callback : NULL);
+   glfwSetWindowFocusCallback(glfw_window, focus ? glfw_focus_callback : NULL);
+   glfwSetWindowRefreshCallback(glfw_window, event_enabled(TSDL_EVENT_WINDOW_EXPOSED) ? glfw_window_refresh_callback : NULL);
+   glfwSetDropCallback(glfw_window, event_enabled(TSDL_EVENT_DROP) ? glfw_drop_callback : NULL);
+   glfwSetMouseButtonCallback(glfw_window, button ? glfw_mouse_button_callback : NULL);
+   glfwSetCursorPosCallback(glfw_window, motion ? glfw_cursor_pos_callback : NULL);
+   glfwSetScrollCallback(glfw_window, event_enabled(TSDL_EVENT_MOUSE_WHEEL) ? glfw_mouse_wheel_callback : NULL);
+   glfwSetCharCallback(glfw_window, event_enabled(TSDL_EVENT_TEXT_INPUT) ? glfw_char_callback : NULL);
+}
+/* Make a context current; the GL state cache is only dropped on an actual switch */
+static void make_current(GLFWwindow *glfw_window)
+{
+   if (glfwGetCurrentContext() == glfw_window)
+      return;
+   glfwMakeContextCurrent(glfw_window);
+   glstate_invalidate();
+}
+/* Which side of each held modifier is down; GLFW's mods bits don't say */
+static int window_mods(GLFWwindow *glfw_window, int glfw_mods)
+{
+   static const struct
    {
-      if (glfwGetKey(glfwGetCurrentContext(), GLFW_KEY_LEFT_SUPER) == GLFW_PRESS)
-         mods |= TSDL_MOD_LSUPER;
-      if (glfwGetKey(glfwGetCurrentContext(), GLFW_KEY_RIGHT_SUPER) == GLFW_PRESS)
-         mods |= TSDL_MOD_RSUPER;
+      int glfw_mod, left_key, right_key, left, right;
+   } sides[] = {
+       {GLFW_MOD_SHIFT, GLFW_KEY_LEFT_SHIFT, GLFW_KEY_RIGHT_SHIFT, TSDL_MOD_LSHIFT, TSDL_MOD_RSHIFT},
+       {GLFW_MOD_CONTROL, GLFW_KEY_LEFT_CONTROL, GLFW_KEY_RIGHT_CONTROL, TSDL_MOD_LCTRL, TSDL_MOD_RCTRL},
+       {GLFW_MOD_ALT, GLFW_KEY_LEFT_ALT, GLFW_KEY_RIGHT_ALT, TSDL_MOD_LALT, TSDL_MOD_RALT},
+       {GLFW_MOD_SUPER, GLFW_KEY_LEFT_SUPER, GLFW_KEY_RIGHT_SUPER, TSDL_MOD_LSUPER, TSDL_MOD_RSUPER},
+   };
+   int mods = TSDL_MOD_NONE;
+   for (size_t i = 0; i < sizeof(sides) / sizeof(sides[0]); i++)
+   {
+      if (!(glfw_mods & sides[i].glfw_mod))
+         continue;
+      int side = TSDL_MOD_NONE;
+      if (glfw_window && glfwGetKey(glfw_window, sides[i].left_key) == GLFW_PRESS)
+         side |= sides[i].left;
+      if (glfw_window && glfwGetKey(glfw_window, sides[i].right_key) == GLFW_PRESS)
+         side |= sides[i].right;
+      // no window to ask (or the key state already moved on): the modifier is still held
+      mods |= side ? side : sides[i].left;
    }
+
    return mods;
 }
+int map_key_mods(int glfw_mods)
+{
+   // the current context may be none at all while a render thread owns the window's
+   return window_mods(glfwGetCurrentContext(), glfw_mods);
+}
 /*
  * Map GLFW key codes to TinySDL key codes
  * This is an explicit mapping of GLFW key codes to TinySDL key codes.
@@ -772,7 +1036,13 @@ void tsdl_swapBuffers(window win)
       log_error(TSDL_ERR_GL, "Attempt to swap logBuffers on null window");
       return;
    }
+   if (render_thread_swap(win))
+      return;
+   if (idle_throttle(track_visible(&win->track)))
+      return;
+   capture_readback(win, win->track.w, win->track.h);
    glfwSwapBuffers(win->glfw_window);
+   frame_swapped(window_getDisplay(win)); // GLFW exposes no present timestamps
 }
 void tsdl_clear(window win)
 {
@@ -781,6 +1051,8 @@ void tsdl_clear(window win)
       log_error(TSDL_ERR_WINDOW, "Attempt to clear window on null window");
       return;
    }
+   if (render_thread_clear(win))
+      return;
    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 }
 void tsdl_clearColor(window win, float r, float g, float b, float a)
@@ -790,7 +1062,9 @@ void tsdl_clearColor(window win, float r, float g, float b, float a)
       log_error(TSDL_ERR_WINDOW, "Attempt to set clear color on null window");
       return;
    }
-   glClearColor(r, g, b, a);
+   if (render_thread_clearColor(win, r, g, b, a))
+      return;
+   glstate_clearColor(r, g, b, a);
 }
 void tsdl_setViewport(window win, int x, int y, int w, int h)
 {
@@ -799,5 +1073,26 @@ void tsdl_setViewport(window win, int x, int y, int w, int h)
       log_error(TSDL_ERR_WINDOW, "Attempt to set viewport on null window");
       return;
    }
-   glViewport(x, y, w, h);
+   if (render_thread_viewport(win, x, y, w, h))
+      return;
+   glstate_viewport(x, y, w, h);
+}
+void tsdl_getDrawableSize(window win, int *w, int *h)
+{
+   if (!win || !win->glfw_window)
+   {
+      log_error(TSDL_ERR_WINDOW, "Attempt to get drawable size of null window");
+      return;
+   }
+   *w = win->track.w;
+   *h = win->track.h;
+}
+void tsdl_makeCurrent(window win)
+{
+   make_current(win->glfw_window);
+}
+void tsdl_releaseCurrent(window win)
+{
+   glfwMakeContextCurrent(NULL);
+   glstate_invalidate();
 }
\ No newline at end of file
@@ -0,0 +1,133 @@
+//  src/tinysdl_display.c
+
+/*
+    Displays
+    =========================================================================
+
+    Backends enumerate their monitors (XRandR outputs, GLFW monitors) at
+    init and again whenever the server reports a change, and pass the
+    list to display_update. Monitors are matched to slots by output name,
+    so an index stays the same while its monitor stays connected, as
+    joystick slots do. Differences from the last list are posted as
+    added, removed and changed events. The first list is the starting
+    layout and posts nothing; it is there to be queried.
+
+    display_at maps a desktop point to the monitor under it. Window
+    placement and anything paced to a refresh rate use it to find the
+    monitor a window is actually on, rather than assuming the primary.
+ */
+
+#include "tinysdl.h"
+#include <string.h>
+
+static struct
+{
+    TSDL_DisplayInfo slots[TSDL_MAX_DISPLAYS]; // Known monitors by index
+    int known;                                 // The starting layout has been taken
+} displays = {0};
+
+// Display Helpers ============================================================
+static void push(TSDL_EventType type, int which)
+{
+    TSDL_Event event = {.type = type};
+    event.data.display.which = which;
+    post_event(&event);
+}
+/* Connected slot with this name that no other monitor in the list has claimed */
+static int find(const char *name, const int *claimed)
+{
+    for (int i = 0; i < TSDL_MAX_DISPLAYS; i++)
+    {
+        if (displays.slots[i].connected && !claimed[i] && strcmp(displays.slots[i].name, name) == 0)
+            return i;
+    }
+
+    return -1;
+}
+static int same(const TSDL_DisplayInfo *a, const TSDL_DisplayInfo *b)
+{
+    return a->primary == b->primary && a->x == b->x && a->y == b->y && a->w == b->w && a->h == b->h &&
+           a->refresh == b->refresh && a->scale == b->scale;
+}
+
+// Display Functions ==========================================================
+void display_update(const TSDL_DisplayInfo *list, int count)
+{
+    int report = displays.known;
+    displays.known = TSDL_TRUE;
+    if (count > TSDL_MAX_DISPLAYS)
+        count = TSDL_MAX_DISPLAYS;
+
+    // match first, so a removal frees its slot before anything new is placed
+    int claimed[TSDL_MAX_DISPLAYS] = {0};
+    int match[TSDL_MAX_DISPLAYS];
+    for (int i = 0; i < count; i++)
+    {
+        match[i] = find(list[i].name, claimed);
+        if (match[i] >= 0)
+            claimed[match[i]] = TSDL_TRUE;
+    }
+    for (int i = 0; i < TSDL_MAX_DISPLAYS; i++)
+    {
+        if (!displays.slots[i].connected || claimed[i])
+            continue;
+        memset(&displays.slots[i], 0, sizeof(TSDL_DisplayInfo));
+        if (report)
+            push(TSDL_EVENT_DISPLAY_REMOVED, i);
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        TSDL_DisplayInfo next = list[i];
+        next.connected = TSDL_TRUE;
+        int slot = match[i];
+        if (slot >= 0)
+        {
+            if (same(&displays.slots[slot], &next))
+                continue;
+            displays.slots[slot] = next;
+            if (report)
+                push(TSDL_EVENT_DISPLAY_CHANGED, slot);
+            continue;
+        }
+        for (slot = 0; slot < TSDL_MAX_DISPLAYS && displays.slots[slot].connected; slot++)
+            ;
+        if (slot == TSDL_MAX_DISPLAYS)
+            break; // more monitors than slots
+        displays.slots[slot] = next;
+        if (report)
+            push(TSDL_EVENT_DISPLAY_ADDED, slot);
+    }
+}
+void display_quit(void)
+{
+    memset(&displays, 0, sizeof(displays));
+}
+int display_state(int index, TSDL_DisplayInfo *info)
+{
+    if (index < 0 || index >= TSDL_MAX_DISPLAYS || !info)
+        return TSDL_FALSE;
+    *info = displays.slots[index];
+
+    return info->connected;
+}
+int display_at(int x, int y)
+{
+    int fallback = -1;
+    for (int i = 0; i < TSDL_MAX_DISPLAYS; i++)
+    {
+        const TSDL_DisplayInfo *d = &displays.slots[i];
+        if (!d->connected)
+            continue;
+        if (x >= d->x && y >= d->y && x < d->x + d->w && y < d->y + d->h)
+            return i;
+        if (fallback < 0 || d->primary)
+            fallback = i; // off every monitor: the primary, else the first
+    }
+
+    return fallback;
+}
+int display_event(TSDL_EventType type)
+{
+    return type == TSDL_EVENT_DISPLAY_ADDED || type == TSDL_EVENT_DISPLAY_REMOVED || type == TSDL_EVENT_DISPLAY_CHANGED;
+}
@@ -0,0 +1,524 @@
+//  src/tinysdl_joystick.c
+
+/*
+    Joystick subsystem
+    =========================================================================
+
+    On Linux joysticks are read straight from evdev. Each /dev/input/eventN
+    node that reports absolute axes plus joystick or gamepad buttons is
+    opened non-blocking. On every pump its input_events are drained in
+    batched read() calls and turned into axis and button events, and a
+    polled state is kept up to date. An inotify watch on the directory
+    picks up hot-plugged nodes, including the attribute change udev makes
+    once a node becomes readable. Removal shows up as ENODEV or IN_DELETE.
+
+    Where evdev can't be used (no /dev/input, or not Linux) the backend's
+    fallback, GLFW's joystick API, is polled and diffed against the last
+    state instead.
+
+    Device slots, the event ring and read buffers are all fixed-size, so
+    polling never allocates. TSDL_EVDEV_DIR points the subsystem at another
+    directory. Nodes there that aren't real evdev devices (a FIFO fed with
+    struct input_event, say) are accepted as stand-ins with a default
+    layout, which is how the subsystem is tested without hardware.
+ */
+
+#include "tinysdl.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/input.h>
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
+#endif
+
+#define JOY_EVENTS 256               // Translated events awaiting pollEvent (power of two)
+#define JOY_READ_BATCH 64            // input_events per read()
+#define JOY_DEFAULT_DIR "/dev/input" // Scanned unless TSDL_EVDEV_DIR is set
+#define JOY_RESYNC_EVENTS (TSDL_JOY_MAX_AXES + TSDL_JOY_MAX_BUTTONS) // Most events one resync can post
+
+#ifdef __linux__
+#define BITS_LONGS(n) (((n) + 8 * sizeof(long) - 1) / (8 * sizeof(long)))
+#define TEST_BIT(bits, n) (((bits)[(n) / (8 * sizeof(long))] >> ((n) % (8 * sizeof(long)))) & 1)
+
+typedef struct
+{
+    int fd;                                    // evdev node (-1 = free slot)
+    int number;                                // N of eventN
+    unsigned char abs_map[ABS_CNT];            // Axis code -> axis index + 1 (0 = unused)
+    unsigned char key_map[KEY_CNT - BTN_MISC]; // Button code -> button index + 1 (0 = unused)
+    int min[TSDL_JOY_MAX_AXES];                // Raw axis range
+    int max[TSDL_JOY_MAX_AXES];                // "
+    int resync;                                // Events were dropped; re-read the state when the ring has room
+} evdev_device;
+#endif
+
+static struct
+{
+    int initialized;                               // joystick_init succeeded
+    TSDL_JoystickFallback fallback;                // Backend query (NULL = none)
+    int use_fallback;                              // evdev unavailable
+    int stand_ins;                                 // Accept non-evdev nodes (TSDL_EVDEV_DIR set)
+    char dir[256];                                 // Directory scanned for eventN nodes
+    int inotify;                                   // Hot-plug watch (-1 = none)
+    TSDL_JoystickState states[TSDL_MAX_JOYSTICKS]; // Polled state per slot
+    TSDL_Event ring[JOY_EVENTS];                   // Events awaiting pollEvent
+    unsigned int head;                             // Next slot to write
+    unsigned int tail;                             // Next slot to read
+#ifdef __linux__
+    evdev_device devices[TSDL_MAX_JOYSTICKS];      // Open evdev nodes
+#endif
+} joy = {.inotify = -1};
+
+// Event Helpers ==============================================================
+static unsigned int ring_free(void)
+{
+    return JOY_EVENTS - (joy.head - joy.tail);
+}
+static void push(TSDL_EventType type, int which, int index, float value)
+{
+    if (!event_enabled(type) || ring_free() == 0)
+        return;
+
+    TSDL_Event *event = &joy.ring[joy.head++ & (JOY_EVENTS - 1)];
+    memset(event, 0, sizeof(TSDL_Event));
+    event->type = type;
+    switch (type)
+    {
+    case TSDL_EVENT_JOY_AXIS:
+        event->data.joy_axis.which = which;
+        event->data.joy_axis.axis = index;
+        event->data.joy_axis.value = value;
+        break;
+    case TSDL_EVENT_JOY_BUTTON_DOWN:
+    case TSDL_EVENT_JOY_BUTTON_UP:
+        event->data.joy_button.which = which;
+        event->data.joy_button.button = index;
+        break;
+    default:
+        event->data.joy_device.which = which;
+        break;
+    }
+}
+static void set_axis(int which, int axis, float value)
+{
+    TSDL_JoystickState *state = &joy.states[which];
+    if (state->axes[axis] == value)
+        return;
+    state->axes[axis] = value;
+    push(TSDL_EVENT_JOY_AXIS, which, axis, value);
+}
+static void set_button(int which, int button, int down)
+{
+    TSDL_JoystickState *state = &joy.states[which];
+    unsigned int bit = 1u << button;
+    if (!(state->buttons & bit) == !down)
+        return;
+    state->buttons ^= bit;
+    push(down ? TSDL_EVENT_JOY_BUTTON_DOWN : TSDL_EVENT_JOY_BUTTON_UP, which, button, 0);
+}
+
+// Fallback Helpers ===========================================================
+/* Poll the backend and turn differences from the last state into events */
+static void pump_fallback(void)
+{
+    for (int i = 0; i < TSDL_MAX_JOYSTICKS && ring_free() > TSDL_JOY_MAX_AXES + TSDL_JOY_MAX_BUTTONS + 1; i++)
+    {
+        TSDL_JoystickState next = {0};
+        int present = joy.fallback(i, &next);
+        TSDL_JoystickState *state = &joy.states[i];
+        if (!present)
+        {
+            if (state->connected)
+            {
+                memset(state, 0, sizeof(TSDL_JoystickState));
+                push(TSDL_EVENT_JOY_REMOVED, i, 0, 0);
+            }
+            continue;
+        }
+        if (!state->connected)
+        {
+            *state = next;
+            state->connected = TSDL_TRUE;
+            push(TSDL_EVENT_JOY_ADDED, i, 0, 0);
+            continue;
+        }
+        for (int a = 0; a < next.axis_count && a < TSDL_JOY_MAX_AXES; a++)
+            set_axis(i, a, next.axes[a]);
+        for (int b = 0; b < next.button_count && b < TSDL_JOY_MAX_BUTTONS; b++)
+            set_button(i, b, (next.buttons >> b) & 1);
+    }
+}
+
+#ifdef __linux__
+// Evdev Helpers ==============================================================
+static float normalize(const evdev_device *device, int axis, int value)
+{
+    int min = device->min[axis], max = device->max[axis];
+    if (max <= min)
+        return 0.0f;
+    float v = 2.0f * (float)(value - min) / (float)(max - min) - 1.0f;
+
+    return v < -1.0f ? -1.0f : (v > 1.0f ? 1.0f : v);
+}
+static int is_event_node(const char *name, int *number)
+{
+    char *end;
+    if (strncmp(name, "event", 5) != 0 || !name[5])
+        return TSDL_FALSE;
+    long n = strtol(name + 5, &end, 10);
+    if (*end || n < 0)
+        return TSDL_FALSE;
+    *number = (int)n;
+
+    return TSDL_TRUE;
+}
+/* Stand-in layout: ABS_X.. as axes over the int16 range, BTN_SOUTH.. as buttons */
+static void default_layout(evdev_device *device, TSDL_JoystickState *state)
+{
+    for (int a = 0; a < TSDL_JOY_MAX_AXES; a++)
+    {
+        device->abs_map[ABS_X + a] = (unsigned char)(a + 1);
+        device->min[a] = -32768;
+        device->max[a] = 32767;
+    }
+    for (int b = 0; b < TSDL_JOY_MAX_BUTTONS; b++)
+        device->key_map[BTN_SOUTH + b - BTN_MISC] = (unsigned char)(b + 1);
+    state->axis_count = TSDL_JOY_MAX_AXES;
+    state->button_count = TSDL_JOY_MAX_BUTTONS;
+    snprintf(state->name, sizeof(state->name), "evdev stand-in");
+}
+/* Map a real evdev node's axes and buttons; 0 if it isn't a joystick, -1 if it isn't evdev */
+static int probe_layout(int fd, evdev_device *device, TSDL_JoystickState *state)
+{
+    unsigned long abs_bits[BITS_LONGS(ABS_CNT)] = {0};
+    unsigned long key_bits[BITS_LONGS(KEY_CNT)] = {0};
+    if (ioctl(fd, EVIOCGBIT(EV_ABS, sizeof(abs_bits)), abs_bits) < 0 ||
+        ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(key_bits)), key_bits) < 0)
+        return -1;
+
+    int buttons = 0;
+    for (int code = BTN_JOYSTICK; code < BTN_DIGI && buttons < TSDL_JOY_MAX_BUTTONS; code++)
+    {
+        if (TEST_BIT(key_bits, code))
+            device->key_map[code - BTN_MISC] = (unsigned char)(++buttons);
+    }
+    for (int code = BTN_TRIGGER_HAPPY; code <= BTN_TRIGGER_HAPPY40 && buttons < TSDL_JOY_MAX_BUTTONS; code++)
+    {
+        if (TEST_BIT(key_bits, code))
+            device->key_map[code - BTN_MISC] = (unsigned char)(++buttons);
+    }
+    if (!buttons || !TEST_BIT(abs_bits, ABS_X))
+        return TSDL_FALSE; // a keyboard, mouse or touchpad
+
+    int axes = 0;
+    for (int code = 0; code < ABS_MISC && axes < TSDL_JOY_MAX_AXES; code++)
+    {
+        struct input_absinfo info;
+        if (!TEST_BIT(abs_bits, code) || ioctl(fd, EVIOCGABS(code), &info) < 0)
+            continue;
+        device->abs_map[code] = (unsigned char)(axes + 1);
+        device->min[axes] = info.minimum;
+        device->max[axes] = info.maximum;
+        state->axes[axes] = normalize(device, axes, info.value);
+        axes++;
+    }
+    state->axis_count = axes;
+    state->button_count = buttons;
+    if (ioctl(fd, EVIOCGNAME(sizeof(state->name) - 1), state->name) < 0)
+        snprintf(state->name, sizeof(state->name), "Joystick");
+
+    return TSDL_TRUE;
+}
+static void open_device(const char *name)
+{
+    int number, slot = -1;
+    if (!is_event_node(name, &number))
+        return;
+    for (int i = 0; i < TSDL_MAX_JOYSTICKS; i++)
+    {
+        if (joy.devices[i].fd >= 0 && joy.devices[i].number == number)
+            return; // already open (IN_ATTRIB after IN_CREATE)
+        if (joy.devices[i].fd < 0 && slot < 0)
+            slot = i;
+    }
+    if (slot < 0)
+        return;
+
+    char path[300];
+    snprintf(path, sizeof(path), "%s/%s", joy.dir, name);
+    int fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0)
+        return; // not readable yet; udev's IN_ATTRIB retries
+
+    evdev_device *device = &joy.devices[slot];
+    TSDL_JoystickState *state = &joy.states[slot];
+    memset(device, 0, sizeof(evdev_device));
+    memset(state, 0, sizeof(TSDL_JoystickState));
+    int probed = probe_layout(fd, device, state);
+    if (probed < 0 && errno == ENOTTY && joy.stand_ins)
+    {
+        default_layout(device, state);
+        probed = TSDL_TRUE;
+    }
+    if (probed <= 0)
+    {
+        close(fd);
+        return;
+    }
+
+    device->fd = fd;
+    device->number = number;
+    state->connected = TSDL_TRUE;
+    push(TSDL_EVENT_JOY_ADDED, slot, 0, 0);
+
+    LOG_INFO("Joystick %d opened: %s (%s, %d axes, %d buttons)", slot, state->name, path, state->axis_count, state->button_count);
+}
+static void close_device(int slot)
+{
+    evdev_device *device = &joy.devices[slot];
+    close(device->fd);
+    device->fd = -1;
+    memset(&joy.states[slot], 0, sizeof(TSDL_JoystickState));
+    push(TSDL_EVENT_JOY_REMOVED, slot, 0, 0);
+
+    LOG_INFO("Joystick %d removed", slot);
+}
+/* After SYN_DROPPED the kernel discarded events; re-read the whole state */
+static void resync(int slot)
+{
+    evdev_device *device = &joy.devices[slot];
+    unsigned long key_state[BITS_LONGS(KEY_CNT)] = {0};
+    if (ioctl(device->fd, EVIOCGKEY(sizeof(key_state)), key_state) >= 0)
+    {
+        for (int code = BTN_MISC; code < KEY_CNT; code++)
+        {
+            int button = device->key_map[code - BTN_MISC] - 1;
+            if (button >= 0)
+                set_button(slot, button, (int)TEST_BIT(key_state, code));
+        }
+    }
+    for (int code = 0; code < ABS_CNT; code++)
+    {
+        struct input_absinfo info;
+        int axis = device->abs_map[code] - 1;
+        if (axis >= 0 && ioctl(device->fd, EVIOCGABS(code), &info) >= 0)
+            set_axis(slot, axis, normalize(device, axis, info.value));
+    }
+}
+static void read_device(int slot)
+{
+    evdev_device *device = &joy.devices[slot];
+    struct input_event batch[JOY_READ_BATCH];
+    int dropped = TSDL_FALSE;
+
+    // stop while the ring can't take a whole batch; the rest waits in the kernel
+    while (ring_free() >= JOY_READ_BATCH)
+    {
+        if (device->resync)
+        {
+            if (ring_free() < JOY_RESYNC_EVENTS)
+                break;
+            device->resync = TSDL_FALSE;
+            resync(slot);
+        }
+        ssize_t n = read(device->fd, batch, sizeof(batch));
+        if (n < 0)
+        {
+            if (errno == ENODEV)
+                close_device(slot);
+            break;
+        }
+
+        size_t count = (size_t)n / sizeof(struct input_event);
+        for (size_t i = 0; i < count && !device->resync; i++)
+        {
+            const struct input_event *ev = &batch[i];
+            if (dropped)
+            {
+                // skip up to the next report, then rebuild the state once the ring can take it all;
+                // the rest of the batch is newer than the report, so the re-read covers it
+                if (ev->type == EV_SYN && ev->code == SYN_REPORT)
+                {
+                    dropped = TSDL_FALSE;
+                    device->resync = TSDL_TRUE;
+                }
+                continue;
+            }
+            if (ev->type == EV_SYN && ev->code == SYN_DROPPED)
+            {
+                dropped = TSDL_TRUE;
+            }
+            else if (ev->type == EV_ABS && ev->code < ABS_CNT && device->abs_map[ev->code])
+            {
+                int axis = device->abs_map[ev->code] - 1;
+                set_axis(slot, axis, normalize(device, axis, ev->value));
+            }
+            else if (ev->type == EV_KEY && ev->code >= BTN_MISC && ev->code < KEY_CNT && ev->value != 2)
+            {
+                int button = device->key_map[ev->code - BTN_MISC] - 1;
+                if (button >= 0)
+                    set_button(slot, button, ev->value);
+            }
+        }
+        if ((size_t)n < sizeof(batch) && !device->resync)
+            break; // drained
+    }
+}
+static void read_hotplug(void)
+{
+    // aligned for struct inotify_event
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    for (;;)
+    {
+        ssize_t n = read(joy.inotify, buffer, sizeof(buffer));
+        if (n <= 0)
+            return;
+
+        for (char *p = buffer; p < buffer + n;)
+        {
+            const struct inotify_event *ev = (const struct inotify_event *)p;
+            p += sizeof(struct inotify_event) + ev->len;
+            int number;
+            if (!ev->len || !is_event_node(ev->name, &number))
+                continue;
+
+            if (ev->mask & (IN_CREATE | IN_ATTRIB | IN_MOVED_TO))
+            {
+                open_device(ev->name);
+            }
+            else if (ev->mask & (IN_DELETE | IN_MOVED_FROM))
+            {
+                for (int i = 0; i < TSDL_MAX_JOYSTICKS; i++)
+                {
+                    if (joy.devices[i].fd >= 0 && joy.devices[i].number == number)
+                        close_device(i);
+                }
+            }
+        }
+    }
+}
+static int init_evdev(void)
+{
+    for (int i = 0; i < TSDL_MAX_JOYSTICKS; i++)
+        joy.devices[i].fd = -1;
+
+    DIR *dir = opendir(joy.dir);
+    if (!dir)
+        return TSDL_FALSE;
+    joy.inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (joy.inotify >= 0 &&
+        inotify_add_watch(joy.inotify, joy.dir, IN_CREATE | IN_ATTRIB | IN_DELETE | IN_MOVED_TO | IN_MOVED_FROM) < 0)
+    {
+        close(joy.inotify);
+        joy.inotify = -1;
+    }
+    if (joy.inotify < 0)
+        LOG_WARN("inotify unavailable; joysticks plugged in later won't be seen");
+
+    for (struct dirent *entry; (entry = readdir(dir));)
+        open_device(entry->d_name);
+    closedir(dir);
+
+    return TSDL_TRUE;
+}
+#endif
+
+// Joystick Functions =========================================================
+int joystick_init(TSDL_JoystickFallback fallback)
+{
+    if (joy.initialized)
+        return TSDL_ERR_NONE;
+
+    const char *dir = getenv("TSDL_EVDEV_DIR");
+    joy.stand_ins = dir != NULL;
+    snprintf(joy.dir, sizeof(joy.dir), "%s", dir ? dir : JOY_DEFAULT_DIR);
+    joy.fallback = fallback;
+    joy.head = joy.tail = 0;
+
+#ifdef __linux__
+    joy.use_fallback = !init_evdev();
+#else
+    joy.use_fallback = TSDL_TRUE;
+#endif
+    if (joy.use_fallback && !fallback)
+        return log_error(TSDL_ERR_INIT, "No joystick source: evdev unavailable and no backend fallback");
+
+    joy.initialized = TSDL_TRUE;
+    LOG_INFO("Initialized joystick subsystem: flags=%d source=%s", TSDL_INIT_JOYSTICK, joy.use_fallback ? "backend" : joy.dir);
+
+    return TSDL_ERR_NONE;
+}
+void joystick_quit(void)
+{
+    if (!joy.initialized)
+        return;
+
+#ifdef __linux__
+    for (int i = 0; i < TSDL_MAX_JOYSTICKS; i++)
+    {
+        if (joy.devices[i].fd >= 0)
+            close(joy.devices[i].fd);
+        joy.devices[i].fd = -1;
+    }
+    if (joy.inotify >= 0)
+        close(joy.inotify);
+#endif
+    joy.inotify = -1;
+    memset(joy.states, 0, sizeof(joy.states));
+    joy.initialized = TSDL_FALSE;
+
+    LOG_INFO("Quit joystick subsystem");
+}
+int joystick_active(void)
+{
+    return joy.initialized;
+}
+int joystick_poll(Event event)
+{
+    if (!joy.initialized)
+        return TSDL_FALSE;
+
+    if (joy.head == joy.tail)
+    {
+        if (joy.use_fallback)
+        {
+            pump_fallback();
+        }
+        else
+        {
+#ifdef __linux__
+            if (joy.inotify >= 0)
+                read_hotplug();
+            for (int i = 0; i < TSDL_MAX_JOYSTICKS; i++)
+            {
+                if (joy.devices[i].fd >= 0)
+                    read_device(i);
+            }
+#endif
+        }
+    }
+
+    // filtered and watched as they leave the ring, like backend events
+    while (joy.head != joy.tail)
+    {
+        *event = joy.ring[joy.tail++ & (JOY_EVENTS - 1)];
+        if (dispatch_event(event))
+            return TSDL_TRUE;
+    }
+
+    return TSDL_FALSE;
+}
+int joystick_state(int index, TSDL_JoystickState *state)
+{
+    if (index < 0 || index >= TSDL_MAX_JOYSTICKS || !state)
+        return TSDL_FALSE;
+    *state = joy.states[index];
+
+    return state->connected;
+}
@@ -1,13 +1,23 @@
 // tinysdl_mock.c
 #include "tinysdl_mock.h"
+#include <errno.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 
 struct tinysdl_window_s
 {
    int dummy;
 };
 
+static struct
+{
+   pthread_mutex_t lock; // Guards wakes
+   pthread_cond_t cond;  // Signalled by mock_wakeEvents
+   unsigned long wakes;  // Bumped per wake, so one posted between poll and wait isn't lost
+} waiter = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0};
+
 int mock_init(int flags)
 {
    // we can check valid flag configurations to mock error consitions
@@ -16,17 +26,71 @@ int mock_init(int flags)
 
    return 0;
 }
+int mock_init_video(void)
+{
+   // one fixed monitor, so display queries have something to answer with
+   static const TSDL_DisplayInfo display = {.primary = TSDL_TRUE, .w = 1920, .h = 1080, .refresh = 60.0, .scale = 1.0f, .name = "MOCK-1"};
+   display_update(&display, 1);
+
+   return mock_init(TSDL_INIT_VIDEO);
+}
 void mock_quit(void)
 {
+   clear_posted_events();
    LOG_STAT("Quit");
 }
-const string mock_getError(void)
+int mock_pollEvent(TSDL_Event *event)
 {
-   return err_trace;
+   return poll_posted_event(event);
 }
-int mock_pollEvent(TSDL_Event *event)
+int mock_waitEvent(TSDL_Event *event, int timeout)
 {
-   return 0;
+   // nothing but posted events to wait for; pushEvent wakes us through mock_wakeEvents
+   struct timespec deadline;
+   clock_gettime(CLOCK_REALTIME, &deadline);
+   deadline.tv_sec += timeout / 1000;
+   deadline.tv_nsec += (long)(timeout % 1000) * 1000000L;
+   if (deadline.tv_nsec >= 1000000000L)
+   {
+      deadline.tv_sec++;
+      deadline.tv_nsec -= 1000000000L;
+   }
+
+   for (;;)
+   {
+      pthread_mutex_lock(&waiter.lock);
+      unsigned long seen = waiter.wakes;
+      pthread_mutex_unlock(&waiter.lock);
+      if (mock_pollEvent(event))
+         return TSDL_TRUE;
+
+      int timed_out = TSDL_FALSE;
+      pthread_mutex_lock(&waiter.lock);
+      while (waiter.wakes == seen && !timed_out)
+      {
+         if (timeout < 0)
+            pthread_cond_wait(&waiter.cond, &waiter.lock);
+         else
+            timed_out = pthread_cond_timedwait(&waiter.cond, &waiter.lock, &deadline) == ETIMEDOUT;
+      }
+      pthread_mutex_unlock(&waiter.lock);
+      if (timed_out)
+         return mock_pollEvent(event);
+   }
+}
+void mock_wakeEvents(void)
+{
+   pthread_mutex_lock(&waiter.lock);
+   waiter.wakes++;
+   pthread_cond_broadcast(&waiter.cond);
+   pthread_mutex_unlock(&waiter.lock);
+}
+void mock_updateEventMask(void)
+{
+}
+const string mock_getVersion(void)
+{
+   return CORE_VER "+00_mock";
 }
 
 window mock_create(string title, int x, int y, int w, int h, int flags)
@@ -77,4 +141,20 @@ void *mock_getGLContext(window win)
    if (!win)
       return NULL;
    return (void *)0xCAFEFEED;
+}
+int mock_setRelativeMouse(window win, int enabled)
+{
+   if (!win)
+      return log_error(TSDL_ERR_WINDOW, "Attempt to set relative mouse on null window");
+   LOG_STAT("Relative mouse=%d", enabled);
+
+   return TSDL_ERR_NONE;
+}
+int mock_isVisible(window win)
+{
+   return win ? TSDL_TRUE : TSDL_FALSE;
+}
+int mock_getDisplay(window win)
+{
+   return win ? display_at(0, 0) : -1;
 }
\ No newline at end of file
@@ -0,0 +1,437 @@
+//  src/tinysdl_replay.c
+
+/*
+    Event recording and replay
+    =========================================================================
+
+    Recording appends every event pollEvent/waitEvent delivers to a
+    memory-mapped log. A record is the microseconds since the previous
+    record, the event type and the type's fields, all as varints (signed
+    fields zigzagged); wheel and relative deltas are raw doubles and drop
+    paths are stored packed, so replay rebuilds the payload in one copy.
+    User events are application output rather than input, and display
+    events describe the machine rather than the session: neither is
+    recorded, and both keep flowing during replay.
+
+    Replay maps a log read-only and feeds it back through pollEvent and
+    waitEvent at the recorded pace scaled by a speed factor, or as fast as
+    it is polled. It sits above the backends, so it works on any of them,
+    the mock included.
+ */
+
+#include "tinysdl.h"
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define REPLAY_MAGIC "TSDLREC1" // File signature
+#define REPLAY_MAGIC_SIZE 8     // Signature bytes
+#define RECORD_CHUNK (1 << 20)  // Log growth step (bytes)
+#define RECORD_MAX 48           // Largest record, excluding drop paths
+
+static struct
+{
+    int fd;                  // Log file (-1 = not recording)
+    unsigned char *map;      // Writable mapping of the whole file
+    size_t size;             // Mapped (and file) size
+    size_t used;             // Bytes written
+    unsigned long long last; // Time of the previous record (us)
+} recorder = {.fd = -1};
+
+static struct
+{
+    const unsigned char *map; // Read-only mapping (NULL = not replaying)
+    size_t size;              // Mapped size
+    size_t pos;               // Next record's type field
+    int done;                 // No records left
+    double speed;             // Playback rate (<= 0 = as fast as polled)
+    unsigned long long start; // When replay started (us)
+    unsigned long long due;   // Log time of the next record (us)
+} player = {0};
+
+// Encoding Helpers ===========================================================
+static unsigned long long now_us(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (unsigned long long)now.tv_sec * 1000000ull + (unsigned long long)now.tv_nsec / 1000;
+}
+static void put_varint(uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        recorder.map[recorder.used++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    recorder.map[recorder.used++] = (unsigned char)value;
+}
+static void put_signed(int64_t value)
+{
+    put_varint(((uint64_t)value << 1) ^ (uint64_t)(value >> 63)); // zigzag
+}
+static void put_double(double value)
+{
+    memcpy(recorder.map + recorder.used, &value, sizeof(double));
+    recorder.used += sizeof(double);
+}
+/* Read a varint at player.pos; TSDL_FALSE on a truncated log */
+static int get_varint(uint64_t *value)
+{
+    *value = 0;
+    for (int shift = 0; shift < 64 && player.pos < player.size; shift += 7)
+    {
+        unsigned char byte = player.map[player.pos++];
+        *value |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return TSDL_TRUE;
+    }
+
+    return TSDL_FALSE;
+}
+static int get_signed(int *value)
+{
+    uint64_t raw;
+    if (!get_varint(&raw))
+        return TSDL_FALSE;
+    *value = (int)(int64_t)((raw >> 1) ^ -(raw & 1));
+
+    return TSDL_TRUE;
+}
+static int get_double(double *value)
+{
+    if (player.size - player.pos < sizeof(double))
+        return TSDL_FALSE;
+    memcpy(value, player.map + player.pos, sizeof(double));
+    player.pos += sizeof(double);
+
+    return TSDL_TRUE;
+}
+
+// Recording Helpers ==========================================================
+/* Make room for n more bytes, growing the file and remapping it */
+static int reserve(size_t n)
+{
+    if (recorder.used + n <= recorder.size)
+        return TSDL_TRUE;
+
+    size_t size = recorder.size + (n > RECORD_CHUNK ? n : RECORD_CHUNK);
+    munmap(recorder.map, recorder.size);
+    recorder.map = NULL;
+    if (ftruncate(recorder.fd, (off_t)size) != 0)
+        return TSDL_FALSE;
+    unsigned char *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, recorder.fd, 0);
+    if (map == MAP_FAILED)
+        return TSDL_FALSE;
+    recorder.map = map;
+    recorder.size = size;
+
+    return TSDL_TRUE;
+}
+static void finish_recording(void)
+{
+    if (recorder.map)
+        munmap(recorder.map, recorder.size);
+    // trim the growth slack so the file ends at the last record
+    if (ftruncate(recorder.fd, (off_t)recorder.used) != 0)
+        log_error(TSDL_ERR, "Failed to trim event log");
+    close(recorder.fd);
+
+    LOG_INFO("Recording stopped: %zu bytes", recorder.used);
+    recorder.fd = -1;
+    recorder.map = NULL;
+    recorder.size = recorder.used = 0;
+}
+
+// Replay Helpers =============================================================
+/* Consume the next record's delta; marks the log done at its end */
+static void advance(void)
+{
+    uint64_t delta;
+    if (player.pos >= player.size || !get_varint(&delta))
+    {
+        player.done = TSDL_TRUE;
+        return;
+    }
+    player.due += delta;
+}
+static int decode(Event event)
+{
+    uint64_t type;
+    if (!get_varint(&type))
+        return TSDL_FALSE;
+
+    memset(event, 0, sizeof(TSDL_Event));
+    event->type = (TSDL_EventType)type;
+    switch (event->type)
+    {
+    case TSDL_EVENT_KEY_DOWN:
+    case TSDL_EVENT_KEY_UP:
+    {
+        uint64_t keycode;
+        if (!get_varint(&keycode))
+            return TSDL_FALSE;
+        event->data.key.keycode = (unsigned int)keycode;
+        return get_signed(&event->data.key.repeat) && get_signed(&event->data.key.mods);
+    }
+    case TSDL_EVENT_WINDOW_RESIZED:
+        return get_signed(&event->data.window_resized.w) && get_signed(&event->data.window_resized.h) &&
+               get_signed(&event->data.window_resized.is_fullscreen);
+    case TSDL_EVENT_WINDOW_MOVED:
+        return get_signed(&event->data.window_moved.x) && get_signed(&event->data.window_moved.y);
+    case TSDL_EVENT_MOUSE_BUTTON_DOWN:
+    case TSDL_EVENT_MOUSE_BUTTON_UP:
+        return get_signed(&event->data.mouse_button.button) && get_signed(&event->data.mouse_button.mods);
+    case TSDL_EVENT_MOUSE_MOVED:
+        return get_signed(&event->data.mouse_moved.x) && get_signed(&event->data.mouse_moved.y);
+    case TSDL_EVENT_MOUSE_WHEEL:
+        return get_double(&event->data.mouse_wheel.xoffset) && get_double(&event->data.mouse_wheel.yoffset);
+    case TSDL_EVENT_MOUSE_RELATIVE:
+        return get_double(&event->data.mouse_relative.dx) && get_double(&event->data.mouse_relative.dy);
+    case TSDL_EVENT_DROP:
+    {
+        uint64_t count, size;
+        if (!get_varint(&count) || !get_varint(&size) || count == 0 || size > player.size - player.pos)
+            return TSDL_FALSE;
+
+        // the packed paths must hold exactly count NUL-terminated strings
+        const char *packed = (const char *)player.map + player.pos;
+        uint64_t terminators = 0;
+        for (uint64_t i = 0; i < size; i++)
+            terminators += packed[i] == '\0';
+        if (terminators != count || packed[size - 1] != '\0')
+            return TSDL_FALSE;
+
+        player.pos += size;
+        event->data.drop.paths = pack_drop_paths((int)count, packed, size);
+        event->data.drop.count = (int)count;
+        return event->data.drop.paths != NULL;
+    }
+    case TSDL_EVENT_JOY_ADDED:
+    case TSDL_EVENT_JOY_REMOVED:
+        return get_signed(&event->data.joy_device.which);
+    case TSDL_EVENT_JOY_AXIS:
+    {
+        double value;
+        if (!get_signed(&event->data.joy_axis.which) || !get_signed(&event->data.joy_axis.axis) || !get_double(&value))
+            return TSDL_FALSE;
+        event->data.joy_axis.value = (float)value;
+        return TSDL_TRUE;
+    }
+    case TSDL_EVENT_JOY_BUTTON_DOWN:
+    case TSDL_EVENT_JOY_BUTTON_UP:
+        return get_signed(&event->data.joy_button.which) && get_signed(&event->data.joy_button.button);
+    case TSDL_EVENT_TEXT_INPUT:
+    {
+        uint64_t len;
+        if (!get_varint(&len) || len >= TSDL_TEXT_INPUT_SIZE || len > player.size - player.pos)
+            return TSDL_FALSE;
+        memcpy(event->data.text.text, player.map + player.pos, len);
+        event->data.text.text[len] = '\0';
+        player.pos += len;
+        return TSDL_TRUE;
+    }
+    default:
+        return TSDL_TRUE;
+    }
+}
+static void finish_replay(void)
+{
+    munmap((void *)player.map, player.size);
+    memset(&player, 0, sizeof(player));
+
+    LOG_INFO("Replay finished");
+}
+
+// Record/Replay Functions ====================================================
+void record_event(const TSDL_Event *event)
+{
+    if (recorder.fd < 0 || event->type >= TSDL_EVENT_USER || display_event(event->type))
+        return;
+
+    size_t paths = 0;
+    if (event->type == TSDL_EVENT_DROP)
+    {
+        for (int i = 0; i < event->data.drop.count; i++)
+            paths += event->data.drop.paths[i].len + 1;
+    }
+    if (!reserve(RECORD_MAX + paths))
+    {
+        log_error(TSDL_ERR, "Failed to grow event log; recording stopped");
+        finish_recording();
+        return;
+    }
+
+    unsigned long long now = now_us();
+    put_varint(now - recorder.last);
+    put_varint(event->type);
+    recorder.last = now;
+    switch (event->type)
+    {
+    case TSDL_EVENT_KEY_DOWN:
+    case TSDL_EVENT_KEY_UP:
+        put_varint(event->data.key.keycode);
+        put_signed(event->data.key.repeat);
+        put_signed(event->data.key.mods);
+        break;
+    case TSDL_EVENT_WINDOW_RESIZED:
+        put_signed(event->data.window_resized.w);
+        put_signed(event->data.window_resized.h);
+        put_signed(event->data.window_resized.is_fullscreen);
+        break;
+    case TSDL_EVENT_WINDOW_MOVED:
+        put_signed(event->data.window_moved.x);
+        put_signed(event->data.window_moved.y);
+        break;
+    case TSDL_EVENT_MOUSE_BUTTON_DOWN:
+    case TSDL_EVENT_MOUSE_BUTTON_UP:
+        put_signed(event->data.mouse_button.button);
+        put_signed(event->data.mouse_button.mods);
+        break;
+    case TSDL_EVENT_MOUSE_MOVED:
+        put_signed(event->data.mouse_moved.x);
+        put_signed(event->data.mouse_moved.y);
+        break;
+    case TSDL_EVENT_MOUSE_WHEEL:
+        put_double(event->data.mouse_wheel.xoffset);
+        put_double(event->data.mouse_wheel.yoffset);
+        break;
+    case TSDL_EVENT_MOUSE_RELATIVE:
+        put_double(event->data.mouse_relative.dx);
+        put_double(event->data.mouse_relative.dy);
+        break;
+    case TSDL_EVENT_DROP:
+        put_varint(event->data.drop.count);
+        put_varint(paths);
+        for (int i = 0; i < event->data.drop.count; i++)
+        {
+            memcpy(recorder.map + recorder.used, event->data.drop.paths[i].str, event->data.drop.paths[i].len + 1);
+            recorder.used += event->data.drop.paths[i].len + 1;
+        }
+        break;
+    case TSDL_EVENT_JOY_ADDED:
+    case TSDL_EVENT_JOY_REMOVED:
+        put_signed(event->data.joy_device.which);
+        break;
+    case TSDL_EVENT_JOY_AXIS:
+        put_signed(event->data.joy_axis.which);
+        put_signed(event->data.joy_axis.axis);
+        put_double(event->data.joy_axis.value);
+        break;
+    case TSDL_EVENT_JOY_BUTTON_DOWN:
+    case TSDL_EVENT_JOY_BUTTON_UP:
+        put_signed(event->data.joy_button.which);
+        put_signed(event->data.joy_button.button);
+        break;
+    case TSDL_EVENT_TEXT_INPUT:
+    {
+        size_t len = strnlen(event->data.text.text, TSDL_TEXT_INPUT_SIZE - 1);
+        put_varint(len);
+        memcpy(recorder.map + recorder.used, event->data.text.text, len);
+        recorder.used += len;
+        break;
+    }
+    default:
+        break;
+    }
+}
+int record_events(const char *path)
+{
+    if (recorder.fd >= 0)
+        finish_recording();
+    if (!path)
+        return TSDL_ERR_NONE;
+
+    recorder.fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (recorder.fd < 0)
+        return log_error(TSDL_ERR, "Failed to open event log for recording");
+    if (!reserve(REPLAY_MAGIC_SIZE))
+    {
+        finish_recording();
+        return log_error(TSDL_ERR, "Failed to map event log");
+    }
+    memcpy(recorder.map, REPLAY_MAGIC, REPLAY_MAGIC_SIZE);
+    recorder.used = REPLAY_MAGIC_SIZE;
+    recorder.last = now_us();
+
+    LOG_INFO("Recording events to %s", path);
+
+    return TSDL_ERR_NONE;
+}
+int replay_events(const char *path, double speed)
+{
+    if (player.map)
+        finish_replay();
+    if (!path)
+        return TSDL_ERR_NONE;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return log_error(TSDL_ERR, "Failed to open event log for replay");
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < REPLAY_MAGIC_SIZE)
+    {
+        close(fd);
+        return log_error(TSDL_ERR, "Event log is empty or unreadable");
+    }
+    const unsigned char *map = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping keeps the file
+    if (map == MAP_FAILED)
+        return log_error(TSDL_ERR, "Failed to map event log");
+    if (memcmp(map, REPLAY_MAGIC, REPLAY_MAGIC_SIZE) != 0)
+    {
+        munmap((void *)map, (size_t)info.st_size);
+        return log_error(TSDL_ERR, "Not a TinySDL event log");
+    }
+
+    player.map = map;
+    player.size = (size_t)info.st_size;
+    player.pos = REPLAY_MAGIC_SIZE;
+    player.speed = speed;
+    player.start = now_us();
+    advance();
+
+    LOG_INFO("Replaying %s (speed=%.2f)", path, speed);
+
+    return TSDL_ERR_NONE;
+}
+int replay_active(void)
+{
+    return player.map != NULL;
+}
+int replay_next(Event event)
+{
+    if (!player.map)
+        return TSDL_FALSE;
+    if (player.done)
+    {
+        finish_replay();
+        return TSDL_FALSE;
+    }
+    if (player.speed > 0 && (double)(now_us() - player.start) * player.speed < (double)player.due)
+        return TSDL_FALSE;
+
+    if (!decode(event))
+    {
+        log_error(TSDL_ERR, "Corrupt event log; replay stopped");
+        finish_replay();
+        return TSDL_FALSE;
+    }
+    advance();
+
+    return TSDL_TRUE;
+}
+int replay_wait_ms(void)
+{
+    if (!player.map || player.done || player.speed <= 0)
+        return 0;
+
+    double due = player.start + (double)player.due / player.speed;
+    double wait = (due - (double)now_us()) / 1000.0;
+
+    return wait > 0 ? (int)wait + 1 : 0;
+}
@@ -0,0 +1,368 @@
+//  src/tsdl_atlas.c
+
+/*
+    Texture atlas
+    =========================================================================
+
+    Packs small RGBA images (sprites, glyphs) into a few large page
+    textures so a frame's worth of draws binds one texture. Each page is
+    packed with a bottom-left skyline: the skyline is a list of horizontal
+    segments and a new rect goes where its top edge ends up lowest.
+    Uploads are glTexSubImage2D into the page.
+
+    Entries are addressed by a generation-checked id, so callers holding
+    an id can tell when it has been evicted. Space on a page is reclaimed
+    when its last entry is removed. When every page is full the least
+    recently used page (by atlas_get) is evicted as a whole, unless it was
+    used this frame.
+ */
+
+#include "internal/tsdl_gl.h"
+#include "internal/tsdl_rendering.h"
+#include <string.h>
+
+#define ATLAS_PADDING 1 // Gap between entries so linear filtering doesn't bleed
+
+typedef struct
+{
+    int x, y, w; // Segment start, height and width
+} skyline_node;
+
+typedef struct
+{
+    GLuint texture;      // Page texture (RGBA8)
+    skyline_node *nodes; // Skyline, sorted by x
+    int node_count;      // Segments in use
+    int live;            // Live entries on the page
+    unsigned long used;  // Frame this page was last used
+} atlas_page;
+
+typedef struct
+{
+    unsigned short gen; // Bumped on free; stale ids stop matching
+    short page;         // Owning page (-1 = free)
+    int x, y, w, h;     // Pixel rect within the page
+    int next_free;      // Free list link
+} atlas_entry;
+
+struct tsdl_atlas_s
+{
+    int w, h;                                    // Page size
+    int max_pages;                               // Page limit before eviction
+    int page_count;                              // Pages created
+    atlas_page pages[TSDL_ATLAS_MAX_PAGES];      // Pages
+    atlas_entry entries[TSDL_ATLAS_MAX_ENTRIES]; // Entry slots
+    int free_head;                               // First free entry slot
+    unsigned long frame;                         // LRU clock
+};
+
+// Skyline Packer =============================================================
+static void skyline_reset(atlas_page *page, int w)
+{
+    page->nodes[0].x = 0;
+    page->nodes[0].y = 0;
+    page->nodes[0].w = w;
+    page->node_count = 1;
+}
+/* Top edge of a w-wide rect placed at node i, or -1 if it doesn't fit */
+static int skyline_fit(const atlas_page *page, int i, int w, int h, int page_w, int page_h)
+{
+    int x = page->nodes[i].x;
+    if (x + w > page_w)
+        return -1;
+
+    int y = 0;
+    for (int remaining = w; remaining > 0; i++)
+    {
+        if (page->nodes[i].y > y)
+            y = page->nodes[i].y;
+        if (y + h > page_h)
+            return -1;
+        remaining -= page->nodes[i].w;
+    }
+
+    return y;
+}
+static int skyline_insert(atlas_page *page, int w, int h, int page_w, int page_h, int *out_x, int *out_y)
+{
+    int best = -1, best_y = page_h + 1, best_w = page_w; // past the bottom, so a full-height fit still wins
+    for (int i = 0; i < page->node_count; i++)
+    {
+        int y = skyline_fit(page, i, w, h, page_w, page_h);
+        if (y < 0)
+            continue;
+        if (y + h < best_y || (y + h == best_y && page->nodes[i].w < best_w))
+        {
+            best = i;
+            best_y = y + h;
+            best_w = page->nodes[i].w;
+        }
+    }
+    if (best < 0 || page->node_count >= page_w)
+        return TSDL_FALSE;
+
+    int x = page->nodes[best].x;
+    int y = best_y - h;
+
+    // insert the new segment, then trim or drop the segments it shadows
+    memmove(&page->nodes[best + 1], &page->nodes[best], sizeof(skyline_node) * (page->node_count - best));
+    page->nodes[best].x = x;
+    page->nodes[best].y = best_y;
+    page->nodes[best].w = w;
+    page->node_count++;
+
+    for (int i = best + 1; i < page->node_count; i++)
+    {
+        skyline_node *prev = &page->nodes[i - 1];
+        skyline_node *node = &page->nodes[i];
+        int shrink = prev->x + prev->w - node->x;
+        if (shrink <= 0)
+            break;
+
+        node->x += shrink;
+        node->w -= shrink;
+        if (node->w > 0)
+            break;
+
+        memmove(node, node + 1, sizeof(skyline_node) * (page->node_count - i - 1));
+        page->node_count--;
+        i--;
+    }
+    // merge neighbours at the same height
+    for (int i = 0; i < page->node_count - 1; i++)
+    {
+        if (page->nodes[i].y == page->nodes[i + 1].y)
+        {
+            page->nodes[i].w += page->nodes[i + 1].w;
+            memmove(&page->nodes[i + 1], &page->nodes[i + 2], sizeof(skyline_node) * (page->node_count - i - 2));
+            page->node_count--;
+            i--;
+        }
+    }
+
+    *out_x = x;
+    *out_y = y;
+
+    return TSDL_TRUE;
+}
+
+// Atlas Helpers ==============================================================
+static int add_page(atlas a)
+{
+    atlas_page *page = &a->pages[a->page_count];
+    page->nodes = Mem.alloc(sizeof(skyline_node) * a->w);
+    if (!page->nodes)
+        return log_error(TSDL_ERR, "Failed to allocate atlas skyline");
+
+    glGenTextures(1, &page->texture);
+    glstate_bindTexture(GL_TEXTURE_2D, page->texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, a->w, a->h, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+    skyline_reset(page, a->w);
+    page->live = 0;
+    page->used = a->frame;
+    a->page_count++;
+
+    LOG_STAT("Atlas page %d created (%dx%d)", a->page_count - 1, a->w, a->h);
+
+    return TSDL_ERR_NONE;
+}
+static void release_entry(atlas a, int slot)
+{
+    atlas_entry *entry = &a->entries[slot];
+    entry->gen++;
+    entry->page = -1;
+    entry->next_free = a->free_head;
+    a->free_head = slot;
+}
+static void evict_page(atlas a, int index)
+{
+    for (int i = 0; i < TSDL_ATLAS_MAX_ENTRIES; i++)
+    {
+        if (a->entries[i].page == index)
+            release_entry(a, i);
+    }
+    skyline_reset(&a->pages[index], a->w);
+    a->pages[index].live = 0;
+
+    LOG_STAT("Atlas page %d evicted", index);
+}
+static atlas_entry *lookup(atlas a, TSDL_AtlasId id)
+{
+    unsigned int slot = (id & 0xFFFF) - 1;
+    if (!id || slot >= TSDL_ATLAS_MAX_ENTRIES)
+        return NULL;
+
+    atlas_entry *entry = &a->entries[slot];
+    if (entry->page < 0 || entry->gen != (id >> 16))
+        return NULL;
+
+    return entry;
+}
+
+// Atlas Functions ============================================================
+atlas create_atlas(int w, int h, int max_pages)
+{
+    if (w <= 0 || h <= 0)
+    {
+        log_error(TSDL_ERR, "Invalid atlas page size");
+        return NULL;
+    }
+
+    atlas a = Mem.alloc(sizeof(struct tsdl_atlas_s));
+    if (!a)
+    {
+        log_error(TSDL_ERR, "Failed to allocate atlas");
+        return NULL;
+    }
+    memset(a, 0, sizeof(struct tsdl_atlas_s));
+    a->w = w;
+    a->h = h;
+    a->max_pages = (max_pages > 0 && max_pages <= TSDL_ATLAS_MAX_PAGES) ? max_pages : TSDL_ATLAS_MAX_PAGES;
+    for (int i = 0; i < TSDL_ATLAS_MAX_ENTRIES; i++)
+    {
+        a->entries[i].page = -1;
+        a->entries[i].next_free = i + 1 < TSDL_ATLAS_MAX_ENTRIES ? i + 1 : -1;
+    }
+    a->free_head = 0;
+
+    if (add_page(a) != TSDL_ERR_NONE)
+    {
+        destroy_atlas(a);
+        return NULL;
+    }
+
+    return a;
+}
+void destroy_atlas(atlas a)
+{
+    if (!a)
+    {
+        log_error(TSDL_ERR, "Attempt to destroy null atlas");
+        return;
+    }
+
+    for (int i = 0; i < a->page_count; i++)
+    {
+        glstate_deleteTexture(a->pages[i].texture);
+        Mem.free(a->pages[i].nodes);
+    }
+    Mem.free(a);
+
+    LOG_STAT("Atlas destroyed");
+}
+TSDL_AtlasId atlas_add(atlas a, int w, int h, const unsigned char *rgba)
+{
+    if (!a || w <= 0 || h <= 0 || w + ATLAS_PADDING > a->w || h + ATLAS_PADDING > a->h)
+    {
+        log_error(TSDL_ERR, "Invalid atlas entry size");
+        return 0;
+    }
+    if (a->free_head < 0)
+    {
+        log_error(TSDL_ERR, "Atlas entry table full");
+        return 0;
+    }
+
+    int page = -1, x = 0, y = 0;
+    for (int i = 0; i < a->page_count && page < 0; i++)
+    {
+        if (skyline_insert(&a->pages[i], w + ATLAS_PADDING, h + ATLAS_PADDING, a->w, a->h, &x, &y))
+            page = i;
+    }
+    if (page < 0 && a->page_count < a->max_pages)
+    {
+        if (add_page(a) != TSDL_ERR_NONE)
+            return 0;
+        page = a->page_count - 1;
+        if (!skyline_insert(&a->pages[page], w + ATLAS_PADDING, h + ATLAS_PADDING, a->w, a->h, &x, &y))
+        {
+            log_error(TSDL_ERR, "Atlas entry doesn't fit a new page");
+            return 0;
+        }
+    }
+    if (page < 0)
+    {
+        int lru = 0;
+        for (int i = 1; i < a->page_count; i++)
+        {
+            if (a->pages[i].used < a->pages[lru].used)
+                lru = i;
+        }
+        if (a->pages[lru].used == a->frame)
+        {
+            log_error(TSDL_ERR, "Atlas full; every page is in use this frame");
+            return 0;
+        }
+        evict_page(a, lru);
+        page = lru;
+        if (!skyline_insert(&a->pages[page], w + ATLAS_PADDING, h + ATLAS_PADDING, a->w, a->h, &x, &y))
+        {
+            log_error(TSDL_ERR, "Atlas entry doesn't fit an evicted page");
+            return 0;
+        }
+    }
+
+    int slot = a->free_head;
+    atlas_entry *entry = &a->entries[slot];
+    a->free_head = entry->next_free;
+    entry->page = page;
+    entry->x = x;
+    entry->y = y;
+    entry->w = w;
+    entry->h = h;
+    a->pages[page].live++;
+    a->pages[page].used = a->frame;
+
+    if (rgba)
+    {
+        glstate_bindTexture(GL_TEXTURE_2D, a->pages[page].texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+    }
+
+    return ((TSDL_AtlasId)entry->gen << 16) | (TSDL_AtlasId)(slot + 1);
+}
+int atlas_get(atlas a, TSDL_AtlasId id, TSDL_AtlasRegion *region)
+{
+    atlas_entry *entry = a ? lookup(a, id) : NULL;
+    if (!entry)
+        return TSDL_FALSE;
+
+    atlas_page *page = &a->pages[entry->page];
+    page->used = a->frame;
+    if (region)
+    {
+        region->texture = page->texture;
+        region->x = entry->x;
+        region->y = entry->y;
+        region->w = entry->w;
+        region->h = entry->h;
+        region->uv.x = (float)entry->x / a->w;
+        region->uv.y = (float)entry->y / a->h;
+        region->uv.w = (float)entry->w / a->w;
+        region->uv.h = (float)entry->h / a->h;
+    }
+
+    return TSDL_TRUE;
+}
+void atlas_remove(atlas a, TSDL_AtlasId id)
+{
+    atlas_entry *entry = a ? lookup(a, id) : NULL;
+    if (!entry)
+        return;
+
+    atlas_page *page = &a->pages[entry->page];
+    release_entry(a, (int)(entry - a->entries));
+    if (--page->live == 0)
+        skyline_reset(page, a->w);
+}
+void atlas_nextFrame(atlas a)
+{
+    if (a)
+        a->frame++;
+}
@@ -0,0 +1,238 @@
+//  src/tsdl_capture.c
+
+/*
+    Asynchronous frame capture
+    =========================================================================
+
+    Each swap issues glReadPixels into one of a small ring of pixel-pack
+    buffers and fences it. Slots are mapped `latency` frames later, once
+    their fence has signalled, so the CPU never waits on the GPU. If the
+    ring is full of unfinished readbacks the new frame is dropped (and
+    counted) rather than stalling the pipeline.
+ */
+
+#include "internal/tsdl_gl.h"
+#include "internal/tsdl_rendering.h"
+#include <stdio.h>
+#include <string.h>
+
+typedef struct
+{
+    GLuint pbo;          // Pixel pack buffer
+    GLsync fence;        // Signalled when the readback has landed
+    unsigned long frame; // Frame number read into this slot
+    int pending;         // Slot holds an unmapped readback
+} capture_slot;
+
+static struct
+{
+    window win;                            // Window being captured (NULL = idle)
+    TSDL_CaptureConfig config;             // Active configuration
+    capture_slot slots[TSDL_CAPTURE_RING]; // Readback ring
+    int ring;                              // Slots in use (latency + 1)
+    int head;                              // Next slot to read into
+    int tail;                              // Oldest pending slot
+    int w, h;                              // Current PBO dimensions
+    unsigned long frame;                   // Frames captured so far
+    unsigned long dropped;                 // Frames skipped to avoid a stall
+    unsigned char *row;                    // Scratch row for PPM conversion
+} capture = {0};
+
+// Capture Helpers ============================================================
+static void write_frame(const unsigned char *pixels, unsigned long frame)
+{
+    char path[512];
+    snprintf(path, sizeof(path), capture.config.path, frame);
+    FILE *file = fopen(path, "wb");
+    if (!file)
+    {
+        log_error(TSDL_ERR, "Failed to open capture file");
+        return;
+    }
+
+    size_t stride = (size_t)capture.w * 4;
+    if (capture.config.format == TSDL_CAPTURE_RAW)
+    {
+        fwrite(pixels, stride, capture.h, file);
+    }
+    else
+    {
+        // PPM is top-down RGB; GL rows are bottom-up RGBA
+        fprintf(file, "P6\n%d %d\n255\n", capture.w, capture.h);
+        for (int y = capture.h - 1; y >= 0; y--)
+        {
+            const unsigned char *src = pixels + (size_t)y * stride;
+            for (int x = 0; x < capture.w; x++)
+            {
+                capture.row[x * 3 + 0] = src[x * 4 + 0];
+                capture.row[x * 3 + 1] = src[x * 4 + 1];
+                capture.row[x * 3 + 2] = src[x * 4 + 2];
+            }
+            fwrite(capture.row, 3, capture.w, file);
+        }
+    }
+    fclose(file);
+}
+static void deliver_slot(capture_slot *slot)
+{
+    size_t size = (size_t)capture.w * capture.h * 4;
+    glstate_bindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo);
+    const unsigned char *pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+    if (pixels)
+    {
+        if (capture.config.format == TSDL_CAPTURE_CALLBACK)
+            capture.config.callback(pixels, capture.w, capture.h, slot->frame, capture.config.user);
+        else
+            write_frame(pixels, slot->frame);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    else
+    {
+        log_error(TSDL_ERR_GL, "Failed to map capture buffer");
+    }
+    glstate_bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    glDeleteSync(slot->fence);
+    slot->fence = NULL;
+    slot->pending = TSDL_FALSE;
+}
+/*
+ * Map every pending slot whose readback is old enough and has completed.
+ * Slots are harvested strictly in order so frames are delivered in sequence.
+ * With `wait` set (resize, shutdown) the fences are waited on instead.
+ */
+static void harvest(int wait)
+{
+    while (capture.slots[capture.tail].pending)
+    {
+        capture_slot *slot = &capture.slots[capture.tail];
+        if (!wait)
+        {
+            if (capture.frame - slot->frame < (unsigned long)capture.config.latency)
+                break;
+            if (glClientWaitSync(slot->fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+                break;
+        }
+        else
+        {
+            glClientWaitSync(slot->fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        }
+        deliver_slot(slot);
+        capture.tail = (capture.tail + 1) % capture.ring;
+    }
+}
+static int resize_slots(int w, int h)
+{
+    harvest(TSDL_TRUE);
+
+    if (capture.row)
+        Mem.free(capture.row);
+    capture.row = Mem.alloc((size_t)w * 3);
+    if (!capture.row)
+        return log_error(TSDL_ERR, "Failed to allocate capture row buffer");
+
+    for (int i = 0; i < capture.ring; i++)
+    {
+        glstate_bindBuffer(GL_PIXEL_PACK_BUFFER, capture.slots[i].pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)w * h * 4, NULL, GL_STREAM_READ);
+    }
+    glstate_bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    capture.w = w;
+    capture.h = h;
+    capture.head = capture.tail = 0;
+
+    LOG_STAT("Capture buffers sized %dx%d", w, h);
+
+    return TSDL_ERR_NONE;
+}
+
+// Capture Functions ==========================================================
+int tsdl_beginCapture(window win, const TSDL_CaptureConfig *config)
+{
+    if (!win || !config)
+        return log_error(TSDL_ERR_WINDOW, "Attempt to capture null window");
+    if (capture.win)
+        return log_error(TSDL_ERR, "Capture already active");
+    if (config->format == TSDL_CAPTURE_CALLBACK ? !config->callback : !config->path)
+        return log_error(TSDL_ERR, "Capture needs a callback or a path");
+
+    capture.config = *config;
+    if (capture.config.latency < 1)
+        capture.config.latency = 1;
+    if (capture.config.latency > TSDL_CAPTURE_RING - 1)
+        capture.config.latency = TSDL_CAPTURE_RING - 1;
+    capture.ring = capture.config.latency + 1;
+
+    for (int i = 0; i < capture.ring; i++)
+    {
+        memset(&capture.slots[i], 0, sizeof(capture_slot));
+        glGenBuffers(1, &capture.slots[i].pbo);
+    }
+    capture.win = win;
+    capture.w = capture.h = 0;
+    capture.head = capture.tail = 0;
+    capture.frame = 0;
+    capture.dropped = 0;
+
+    LOG_STAT("Capture started: format=%d latency=%d", capture.config.format, capture.config.latency);
+
+    return TSDL_ERR_NONE;
+}
+void tsdl_endCapture(window win)
+{
+    if (!capture.win || capture.win != win)
+        return;
+
+    harvest(TSDL_TRUE);
+    for (int i = 0; i < capture.ring; i++)
+    {
+        glstate_deleteBuffer(capture.slots[i].pbo);
+        capture.slots[i].pbo = 0;
+    }
+    if (capture.row)
+    {
+        Mem.free(capture.row);
+        capture.row = NULL;
+    }
+    capture.win = NULL;
+
+    LOG_STAT("Capture stopped: frames=%lu dropped=%lu", capture.frame, capture.dropped);
+}
+unsigned long tsdl_getCaptureDropped(void)
+{
+    return capture.dropped;
+}
+void capture_readback(window win, int w, int h)
+{
+    if (capture.win != win || w <= 0 || h <= 0)
+        return;
+
+    if (w != capture.w || h != capture.h)
+    {
+        if (resize_slots(w, h) != TSDL_ERR_NONE)
+            return;
+    }
+    else
+    {
+        harvest(TSDL_FALSE);
+    }
+
+    capture_slot *slot = &capture.slots[capture.head];
+    if (slot->pending)
+    {
+        capture.dropped++;
+        capture.frame++;
+        return;
+    }
+
+    glstate_bindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo);
+    glReadBuffer(GL_BACK);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glstate_bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot->frame = capture.frame++;
+    slot->pending = TSDL_TRUE;
+    capture.head = (capture.head + 1) % capture.ring;
+}
@@ -0,0 +1,228 @@
+//  src/tsdl_glstate.c
+
+/*
+    GL state cache
+    =========================================================================
+
+    A shadow of the GL state TinySDL touches. Setters compare against the
+    shadow and skip the driver call when nothing changes. State is unknown
+    until first set.
+
+    There is one shadow, for whichever context is current, not one per
+    context. The backends drop it with glstate_invalidate whenever they
+    make a different context current. GL calls made outside these
+    wrappers aren't seen: code that changes shadowed state with raw gl*
+    calls has to call glstate_invalidate afterwards.
+ */
+
+#include "internal/tsdl_gl.h"
+#include "internal/tsdl_rendering.h"
+#include <string.h>
+
+#define KNOWN_VIEWPORT (1u << 0)
+#define KNOWN_CLEAR (1u << 1)
+#define KNOWN_UNIT (1u << 2)
+#define KNOWN_PROGRAM (1u << 3)
+#define KNOWN_VAO (1u << 4)
+#define KNOWN_BLEND (1u << 5)
+#define KNOWN_BLEND_FUNC (1u << 6)
+#define KNOWN_ARRAY_BUFFER (1u << 7)
+#define KNOWN_PACK_BUFFER (1u << 8)
+#define KNOWN_UNPACK_BUFFER (1u << 9)
+#define KNOWN_TEXTURE(unit) (1u << (16 + (unit)))
+
+static struct
+{
+    unsigned int known;                  // KNOWN_* bits for valid shadow entries
+    GLint viewport[4];                   // x, y, w, h
+    GLfloat clear_color[4];              // r, g, b, a
+    GLenum unit;                         // Active texture unit (GL_TEXTURE0 + n)
+    GLuint textures[TSDL_GLSTATE_UNITS]; // GL_TEXTURE_2D binding per unit
+    GLuint array_buffer;                 // GL_ARRAY_BUFFER binding
+    GLuint pack_buffer;                  // GL_PIXEL_PACK_BUFFER binding
+    GLuint unpack_buffer;                // GL_PIXEL_UNPACK_BUFFER binding
+    GLuint program;                      // Current program
+    GLuint vao;                          // Bound vertex array
+    GLboolean blend;                     // GL_BLEND enabled
+    GLenum blend_src, blend_dst;         // Blend factors
+    TSDL_GLStateStats stats;             // Issued/skipped counters
+} glstate = {0};
+
+// Shadow Helpers =============================================================
+static inline int skip(unsigned int bit, int same)
+{
+    if ((glstate.known & bit) && same)
+    {
+        glstate.stats.skipped++;
+        return TSDL_TRUE;
+    }
+    glstate.known |= bit;
+    glstate.stats.issued++;
+
+    return TSDL_FALSE;
+}
+static GLuint *buffer_slot(GLenum target, unsigned int *bit)
+{
+    switch (target)
+    {
+    case GL_ARRAY_BUFFER:
+        *bit = KNOWN_ARRAY_BUFFER;
+        return &glstate.array_buffer;
+    case GL_PIXEL_PACK_BUFFER:
+        *bit = KNOWN_PACK_BUFFER;
+        return &glstate.pack_buffer;
+    case GL_PIXEL_UNPACK_BUFFER:
+        *bit = KNOWN_UNPACK_BUFFER;
+        return &glstate.unpack_buffer;
+    default:
+        return NULL;
+    }
+}
+static int active_unit(void)
+{
+    // texture binds before any glstate_activeTexture target unit 0, the GL default
+    if (!(glstate.known & KNOWN_UNIT))
+    {
+        glstate.unit = GL_TEXTURE0;
+        glstate.known |= KNOWN_UNIT;
+    }
+
+    return (int)(glstate.unit - GL_TEXTURE0);
+}
+
+// State Cache Functions ======================================================
+void glstate_invalidate(void)
+{
+    glstate.known = 0;
+}
+void glstate_viewport(GLint x, GLint y, GLsizei w, GLsizei h)
+{
+    GLint *v = glstate.viewport;
+    if (skip(KNOWN_VIEWPORT, v[0] == x && v[1] == y && v[2] == w && v[3] == h))
+        return;
+    v[0] = x;
+    v[1] = y;
+    v[2] = w;
+    v[3] = h;
+    glViewport(x, y, w, h);
+}
+void glstate_clearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a)
+{
+    GLfloat *c = glstate.clear_color;
+    if (skip(KNOWN_CLEAR, c[0] == r && c[1] == g && c[2] == b && c[3] == a))
+        return;
+    c[0] = r;
+    c[1] = g;
+    c[2] = b;
+    c[3] = a;
+    glClearColor(r, g, b, a);
+}
+void glstate_activeTexture(GLenum unit)
+{
+    if (skip(KNOWN_UNIT, glstate.unit == unit))
+        return;
+    glstate.unit = unit;
+    glActiveTexture(unit);
+}
+void glstate_bindTexture(GLenum target, GLuint texture)
+{
+    int unit = active_unit();
+    if (target != GL_TEXTURE_2D || unit >= TSDL_GLSTATE_UNITS)
+    {
+        glstate.stats.issued++;
+        glBindTexture(target, texture);
+        return;
+    }
+    if (skip(KNOWN_TEXTURE(unit), glstate.textures[unit] == texture))
+        return;
+    glstate.textures[unit] = texture;
+    glBindTexture(target, texture);
+}
+void glstate_bindBuffer(GLenum target, GLuint buffer)
+{
+    unsigned int bit = 0;
+    GLuint *slot = buffer_slot(target, &bit);
+    if (!slot)
+    {
+        glstate.stats.issued++;
+        glBindBuffer(target, buffer);
+        return;
+    }
+    if (skip(bit, *slot == buffer))
+        return;
+    *slot = buffer;
+    glBindBuffer(target, buffer);
+}
+void glstate_useProgram(GLuint program)
+{
+    if (skip(KNOWN_PROGRAM, glstate.program == program))
+        return;
+    glstate.program = program;
+    glUseProgram(program);
+}
+void glstate_bindVertexArray(GLuint vao)
+{
+    if (skip(KNOWN_VAO, glstate.vao == vao))
+        return;
+    glstate.vao = vao;
+    glBindVertexArray(vao);
+}
+void glstate_setBlend(GLboolean enabled)
+{
+    if (skip(KNOWN_BLEND, glstate.blend == enabled))
+        return;
+    glstate.blend = enabled;
+    if (enabled)
+        glEnable(GL_BLEND);
+    else
+        glDisable(GL_BLEND);
+}
+void glstate_blendFunc(GLenum src, GLenum dst)
+{
+    if (skip(KNOWN_BLEND_FUNC, glstate.blend_src == src && glstate.blend_dst == dst))
+        return;
+    glstate.blend_src = src;
+    glstate.blend_dst = dst;
+    glBlendFunc(src, dst);
+}
+void glstate_deleteTexture(GLuint texture)
+{
+    // GL unbinds a deleted texture from every unit
+    for (int i = 0; i < TSDL_GLSTATE_UNITS; i++)
+    {
+        if (glstate.textures[i] == texture)
+            glstate.textures[i] = 0;
+    }
+    glDeleteTextures(1, &texture);
+}
+void glstate_deleteBuffer(GLuint buffer)
+{
+    if (glstate.array_buffer == buffer)
+        glstate.array_buffer = 0;
+    if (glstate.pack_buffer == buffer)
+        glstate.pack_buffer = 0;
+    if (glstate.unpack_buffer == buffer)
+        glstate.unpack_buffer = 0;
+    glDeleteBuffers(1, &buffer);
+}
+void glstate_deleteProgram(GLuint program)
+{
+    // a program in use stays current until replaced, so keep the shadow
+    glDeleteProgram(program);
+}
+void glstate_deleteVertexArray(GLuint vao)
+{
+    if (glstate.vao == vao)
+        glstate.vao = 0;
+    glDeleteVertexArrays(1, &vao);
+}
+
+// Stats Functions ============================================================
+TSDL_GLStateStats tsdl_getGLStateStats(void)
+{
+    return glstate.stats;
+}
+void tsdl_resetGLStateStats(void)
+{
+    memset(&glstate.stats, 0, sizeof(glstate.stats));
+}
@@ -0,0 +1,249 @@
+//  src/tsdl_pacing.c
+
+/*
+    Idle pacing
+    =========================================================================
+
+    A loop that clears and swaps every frame keeps doing so while its
+    window is minimized or covered, and vsync doesn't block on a surface
+    nobody can see, so it spins a core. With an idle rate set, the backend
+    asks idle_throttle before presenting: while the window can't be seen
+    the swap is dropped and the swapping thread sleeps out the rest of an
+    idle frame instead. The first visible swap resumes normal pacing.
+
+    Frame timing
+    -------------------------------------------------------------------------
+
+    After every swap the backend reports back. With GLX_OML_sync_control
+    it passes the sync counters: the time of the latest vblank (UST), the
+    vblank count (MSC) and the completed swap count (SBC). Vblanks that
+    went by with no swap completing are missed frames, and the refresh
+    interval is measured from UST/MSC deltas. UST is taken to be
+    CLOCK_MONOTONIC in microseconds, which is what Mesa and the
+    proprietary drivers report.
+
+    Without the extension the time a blocking swap returns is snapped to
+    a vblank grid at the refresh rate of the window's monitor. The grid's
+    phase follows the observed returns, and a swap that lands more than
+    one interval after the last counts the skipped vblanks as missed.
+    This is an estimate: with vsync off, or a driver that doesn't block
+    in swap, it only reports the refresh rate.
+
+    Late latch
+    -------------------------------------------------------------------------
+
+    tsdl_beginFrame/tsdl_endFrame bracket a frame. With a latch margin
+    set, beginFrame sleeps until just before the predicted vblank, so
+    the input polled after it is as fresh as it can be when the frame is
+    shown. The wake-up time leaves the margin plus the recent cost of a
+    frame, measured from begin to the swap. That cost is a decaying
+    maximum, so a single slow frame pushes the wake-up earlier for a
+    while rather than missing once per spike.
+ */
+
+#include "internal/tsdl_rendering.h"
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#define NSEC_PER_SEC 1000000000L
+#define DEFAULT_REFRESH 60.0 // Assumed when the monitor doesn't report one
+#define COST_DECAY 0.98      // Per-frame decay of the frame cost estimate
+
+static struct
+{
+    _Atomic long period;  // Idle frame length in ns (0 = off); set from any thread
+    struct timespec next; // Start of the next idle frame (tv_sec 0 = not idling)
+} idle = {0};
+
+static struct
+{
+    pthread_mutex_t lock; // Swaps may time on the render thread while the app reads
+    TSDL_FrameTiming out; // Published counters (next_vblank is filled in on read)
+    double vblank;        // A vblank time the grid is anchored to (0 = not locked)
+    long long ust, msc;   // OML counters when a swap last completed
+    long long sbc;        // Completed swaps at that point (0 = no baseline)
+} timing = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+static struct
+{
+    _Atomic double margin; // Slack kept before the vblank, in seconds (0 = latch off)
+    _Atomic double start;  // When the current frame began
+    _Atomic double cost;   // Recent worst begin-to-swap time, decaying
+} latch = {0};
+
+// Pacing Helpers =============================================================
+static void add_ns(struct timespec *t, long ns)
+{
+    t->tv_nsec += ns;
+    while (t->tv_nsec >= NSEC_PER_SEC)
+    {
+        t->tv_nsec -= NSEC_PER_SEC;
+        t->tv_sec++;
+    }
+}
+static int before(const struct timespec *a, const struct timespec *b)
+{
+    return a->tv_sec < b->tv_sec || (a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec);
+}
+static double now_seconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+/* Refresh interval of a monitor, in seconds */
+static double display_interval(int display)
+{
+    TSDL_DisplayInfo info;
+    if (display_state(display, &info) && info.refresh > 0)
+        return 1.0 / info.refresh;
+
+    return 1.0 / DEFAULT_REFRESH;
+}
+/* Drop the vblank lock; a gap in presenting (idle, a hidden window) isn't jank */
+static void unlock_grid(void)
+{
+    pthread_mutex_lock(&timing.lock);
+    timing.vblank = 0;
+    timing.sbc = 0;
+    pthread_mutex_unlock(&timing.lock);
+}
+
+// Pacing Functions ===========================================================
+void tsdl_setIdleRate(int hz)
+{
+    atomic_store(&idle.period, hz > 0 ? NSEC_PER_SEC / hz : 0);
+}
+int idle_throttle(int visible)
+{
+    long period = atomic_load(&idle.period);
+    if (!period || visible)
+    {
+        idle.next.tv_sec = 0;
+        return TSDL_FALSE;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    // fixed cadence while idling; restart it after a stall rather than catching up
+    if (idle.next.tv_sec == 0 || before(&idle.next, &now))
+        idle.next = now;
+    add_ns(&idle.next, period);
+    unlock_grid();
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &idle.next, NULL) == EINTR)
+        ;
+
+    return TSDL_TRUE;
+}
+
+// Frame Timing Functions =====================================================
+TSDL_FrameTiming tsdl_getFrameTiming(void)
+{
+    pthread_mutex_lock(&timing.lock);
+    TSDL_FrameTiming out = timing.out;
+    double vblank = timing.vblank;
+    pthread_mutex_unlock(&timing.lock);
+
+    // the first grid line after now
+    if (vblank > 0 && out.interval > 0)
+        out.next_vblank = vblank + out.interval * (floor((now_seconds() - vblank) / out.interval) + 1);
+
+    return out;
+}
+void tsdl_resetFrameTiming(void)
+{
+    pthread_mutex_lock(&timing.lock);
+    timing.out.frames = 0;
+    timing.out.missed = 0;
+    pthread_mutex_unlock(&timing.lock);
+}
+void frame_swapped(int display)
+{
+    double now = now_seconds();
+    double interval = display_interval(display);
+
+    pthread_mutex_lock(&timing.lock);
+    if (timing.vblank <= 0 || timing.out.precise || interval != timing.out.interval)
+    {
+        timing.vblank = now;
+    }
+    else
+    {
+        // a swap that returns early (not blocked) still lands on the next vblank
+        long periods = lround((now - timing.vblank) / interval);
+        if (periods < 1)
+            periods = 1;
+        double predicted = timing.vblank + periods * interval;
+        timing.vblank = predicted + (now - predicted) / 4; // follow the returns, damped
+        timing.out.missed += periods - 1;
+    }
+    timing.out.interval = interval;
+    timing.out.last_present = timing.vblank;
+    timing.out.precise = TSDL_FALSE;
+    timing.out.frames++;
+    pthread_mutex_unlock(&timing.lock);
+}
+void frame_vblank(int display, long long ust, long long msc, long long sbc)
+{
+    pthread_mutex_lock(&timing.lock);
+    if (!timing.out.precise)
+        timing.out.interval = display_interval(display); // until two vblanks have been seen
+    timing.out.precise = TSDL_TRUE;
+    if (timing.sbc > 0 && msc > timing.msc)
+        timing.out.interval = (ust - timing.ust) / 1e6 / (msc - timing.msc);
+    timing.vblank = ust / 1e6;
+
+    // only the query after a swap completes says anything about presenting
+    if (timing.sbc == 0 || sbc > timing.sbc)
+    {
+        if (timing.sbc > 0)
+        {
+            long long swaps = sbc - timing.sbc, vblanks = msc - timing.msc;
+            timing.out.frames += swaps;
+            if (vblanks > swaps)
+                timing.out.missed += vblanks - swaps;
+        }
+        timing.ust = ust;
+        timing.msc = msc;
+        timing.sbc = sbc > 0 ? sbc : 1;
+        timing.out.last_present = timing.vblank;
+    }
+    pthread_mutex_unlock(&timing.lock);
+}
+
+// Late Latch Functions =======================================================
+void tsdl_setLateLatch(int margin_us)
+{
+    atomic_store(&latch.margin, margin_us > 0 ? margin_us / 1e6 : 0);
+    atomic_store(&latch.cost, 0);
+}
+void tsdl_beginFrame(window win)
+{
+    // a render thread swaps asynchronously; there is no deadline to aim for from here
+    double margin = atomic_load(&latch.margin);
+    if (margin > 0 && !render_thread_owns(win))
+    {
+        TSDL_FrameTiming now = tsdl_getFrameTiming();
+        double wake = now.next_vblank - atomic_load(&latch.cost) - margin;
+        if (now.next_vblank > 0 && wake > now_seconds())
+        {
+            // split whole nanoseconds, so rounding can't leave tv_nsec at 1e9
+            long long ns = llround(wake * NSEC_PER_SEC);
+            struct timespec until = {.tv_sec = (time_t)(ns / NSEC_PER_SEC), .tv_nsec = (long)(ns % NSEC_PER_SEC)};
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) == EINTR)
+                ;
+        }
+    }
+    atomic_store(&latch.start, now_seconds());
+}
+void tsdl_endFrame(window win)
+{
+    double cost = now_seconds() - atomic_load(&latch.start);
+    double decayed = atomic_load(&latch.cost) * COST_DECAY;
+    atomic_store(&latch.cost, cost > decayed ? cost : decayed);
+    tsdl_swapBuffers(win);
+}
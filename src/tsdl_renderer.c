@@ -0,0 +1,492 @@
+//  src/tsdl_renderer.c
+
+/*
+    Batched 2D renderer
+    =========================================================================
+
+    Every primitive is expanded to a quad (two triangles) and written
+    straight into one vertex buffer, so rects, lines and textured quads
+    share a single shader and differ only by texture. Untextured draws
+    sample a 1x1 white texture. Consecutive quads with the same layer and
+    texture are merged into one batch item as they are recorded, and
+    update_renderer sorts the items by (layer, texture) and issues one
+    glMultiDrawArrays per distinct state.
+
+    The buffer is split into TSDL_RENDERER_REGIONS regions used round-robin
+    and guarded by fences. With ARB_buffer_storage it is mapped persistently
+    once; otherwise each region is mapped unsynchronized while recording,
+    which is safe because the fences keep us off regions still in use.
+ */
+
+#include "internal/tsdl_gl.h"
+#include "internal/tsdl_rendering.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define QUAD_VERTS 6
+#define REGION_VERTS (TSDL_RENDERER_MAX_QUADS * QUAD_VERTS)
+
+typedef struct
+{
+    float x, y;         // Position (window pixels)
+    float u, v;         // Texture coordinates
+    unsigned char c[4]; // RGBA
+} vertex;
+
+typedef struct
+{
+    unsigned long long key; // (layer << 32) | texture
+    GLint first;            // First vertex (absolute)
+    GLsizei count;          // Vertex count
+    unsigned int seq;       // Record order; keeps the sort stable
+} batch_item;
+
+struct tsdl_renderer_s
+{
+    window win;                           // Target window
+    GLuint program;                       // Shared quad shader
+    GLuint vao;                           // Vertex layout
+    GLuint vbo;                           // Vertex buffer (all regions)
+    GLuint white;                         // 1x1 white texture for untextured draws
+    GLint u_scale;                        // Pixel-to-clip scale uniform
+    int persistent;                       // Buffer is persistently mapped
+    vertex *base;                         // Persistent mapping of the whole buffer
+    vertex *mapped;                       // Write pointer for the current region
+    GLsync fences[TSDL_RENDERER_REGIONS]; // Fence per region, set at flush
+    int region;                           // Region being recorded
+    int quads;                            // Quads recorded in the region
+    batch_item *items;                    // Batch items for the region
+    int item_count;                       // Items recorded
+    GLint *firsts;                        // Multi-draw scratch
+    GLsizei *counts;                      // Multi-draw scratch
+    unsigned long long layer;             // Biased layer, pre-shifted into key position
+    int w, h;                             // Size the scale uniform was set for
+    TSDL_RendererStats stats;             // Counters from the last flush
+};
+
+static const char *vertex_src =
+    "#version 330 core\n"
+    "layout(location = 0) in vec2 a_pos;\n"
+    "layout(location = 1) in vec2 a_uv;\n"
+    "layout(location = 2) in vec4 a_color;\n"
+    "uniform vec2 u_scale;\n"
+    "out vec2 v_uv;\n"
+    "out vec4 v_color;\n"
+    "void main()\n"
+    "{\n"
+    "    v_uv = a_uv;\n"
+    "    v_color = a_color;\n"
+    "    gl_Position = vec4(a_pos * u_scale + vec2(-1.0, 1.0), 0.0, 1.0);\n"
+    "}\n";
+static const char *fragment_src =
+    "#version 330 core\n"
+    "in vec2 v_uv;\n"
+    "in vec4 v_color;\n"
+    "uniform sampler2D u_tex;\n"
+    "out vec4 o_color;\n"
+    "void main()\n"
+    "{\n"
+    "    o_color = texture(u_tex, v_uv) * v_color;\n"
+    "}\n";
+
+// Renderer Helpers ===========================================================
+static GLuint compile_shader(GLenum type, const char *src)
+{
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &src, NULL);
+    glCompileShader(shader);
+
+    GLint ok = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+    if (!ok)
+    {
+        char info[256];
+        glGetShaderInfoLog(shader, sizeof(info), NULL, info);
+        LOG_WARN("Shader compile failed: %s", info);
+        glDeleteShader(shader);
+        return 0;
+    }
+
+    return shader;
+}
+static GLuint link_program(void)
+{
+    GLuint vs = compile_shader(GL_VERTEX_SHADER, vertex_src);
+    GLuint fs = compile_shader(GL_FRAGMENT_SHADER, fragment_src);
+    if (!vs || !fs)
+    {
+        glDeleteShader(vs);
+        glDeleteShader(fs);
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vs);
+    glAttachShader(program, fs);
+    glLinkProgram(program);
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+
+    GLint ok = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &ok);
+    if (!ok)
+    {
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    return program;
+}
+static int has_buffer_storage(void)
+{
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    if (major > 4 || (major == 4 && minor >= 4))
+        return TSDL_TRUE;
+
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++)
+    {
+        const char *ext = (const char *)glGetStringi(GL_EXTENSIONS, i);
+        if (ext && strcmp(ext, "GL_ARB_buffer_storage") == 0)
+            return TSDL_TRUE;
+    }
+
+    return TSDL_FALSE;
+}
+static int compare_items(const void *a, const void *b)
+{
+    const batch_item *ia = a;
+    const batch_item *ib = b;
+    if (ia->key != ib->key)
+        return ia->key < ib->key ? -1 : 1;
+
+    return ia->seq < ib->seq ? -1 : 1;
+}
+/*
+ * Wait for the GPU to release the current region, then make it writable.
+ * The wait only blocks when the GPU is TSDL_RENDERER_REGIONS flushes behind.
+ */
+static int acquire_region(renderer r)
+{
+    GLsync fence = r->fences[r->region];
+    if (fence)
+    {
+        glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        glDeleteSync(fence);
+        r->fences[r->region] = NULL;
+    }
+
+    if (r->persistent)
+    {
+        r->mapped = r->base + (size_t)r->region * REGION_VERTS;
+    }
+    else
+    {
+        glstate_bindBuffer(GL_ARRAY_BUFFER, r->vbo);
+        r->mapped = glMapBufferRange(GL_ARRAY_BUFFER,
+                                     (GLintptr)r->region * REGION_VERTS * sizeof(vertex),
+                                     REGION_VERTS * sizeof(vertex),
+                                     GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+        if (!r->mapped)
+            return log_error(TSDL_ERR_GL, "Failed to map renderer vertex region");
+    }
+
+    return TSDL_ERR_NONE;
+}
+/*
+ * Reserve one quad under the given texture and return its six vertices.
+ * Contiguous quads with the same key extend the last item instead of
+ * adding a new one, so a run of same-state draws costs one item.
+ */
+static vertex *push_quad(renderer r, GLuint texture)
+{
+    if (r->quads == TSDL_RENDERER_MAX_QUADS)
+        update_renderer(r);
+    if (!r->mapped && acquire_region(r) != TSDL_ERR_NONE)
+        return NULL;
+
+    unsigned long long key = r->layer | texture;
+    GLint first = r->region * REGION_VERTS + r->quads * QUAD_VERTS;
+    batch_item *last = r->item_count ? &r->items[r->item_count - 1] : NULL;
+    if (last && last->key == key && last->first + last->count == first)
+    {
+        last->count += QUAD_VERTS;
+    }
+    else
+    {
+        batch_item *item = &r->items[r->item_count];
+        item->key = key;
+        item->first = first;
+        item->count = QUAD_VERTS;
+        item->seq = r->item_count++;
+    }
+
+    return r->mapped + (size_t)r->quads++ * QUAD_VERTS;
+}
+static inline void set_vertex(vertex *v, float x, float y, float u, float t, TSDL_Color color)
+{
+    v->x = x;
+    v->y = y;
+    v->u = u;
+    v->v = t;
+    v->c[0] = color.r;
+    v->c[1] = color.g;
+    v->c[2] = color.b;
+    v->c[3] = color.a;
+}
+/* Corners are given clockwise from the top-left; uv spans the texture rect */
+static void write_quad(vertex *v, const float *xy, TSDL_Rect uv, TSDL_Color color)
+{
+    float u0 = uv.x, v0 = uv.y, u1 = uv.x + uv.w, v1 = uv.y + uv.h;
+    set_vertex(&v[0], xy[0], xy[1], u0, v0, color);
+    set_vertex(&v[1], xy[2], xy[3], u1, v0, color);
+    set_vertex(&v[2], xy[4], xy[5], u1, v1, color);
+    set_vertex(&v[3], xy[0], xy[1], u0, v0, color);
+    set_vertex(&v[4], xy[4], xy[5], u1, v1, color);
+    set_vertex(&v[5], xy[6], xy[7], u0, v1, color);
+}
+
+// Renderer Functions =========================================================
+renderer create_renderer(window win)
+{
+    if (!win)
+    {
+        log_error(TSDL_ERR_WINDOW, "Attempt to create renderer on null window");
+        return NULL;
+    }
+
+    renderer r = Mem.alloc(sizeof(struct tsdl_renderer_s));
+    if (!r)
+    {
+        log_error(TSDL_ERR, "Failed to allocate renderer");
+        return NULL;
+    }
+    memset(r, 0, sizeof(struct tsdl_renderer_s));
+    r->win = win;
+    r->layer = 0x80000000ULL << 32;
+    r->items = Mem.alloc(sizeof(batch_item) * TSDL_RENDERER_MAX_QUADS);
+    r->firsts = Mem.alloc(sizeof(GLint) * TSDL_RENDERER_MAX_QUADS);
+    r->counts = Mem.alloc(sizeof(GLsizei) * TSDL_RENDERER_MAX_QUADS);
+    if (!r->items || !r->firsts || !r->counts)
+    {
+        destroy_renderer(r);
+        log_error(TSDL_ERR, "Failed to allocate renderer batch");
+        return NULL;
+    }
+
+    r->program = link_program();
+    if (!r->program)
+    {
+        destroy_renderer(r);
+        log_error(TSDL_ERR_GL, "Failed to build renderer shader");
+        return NULL;
+    }
+    r->u_scale = glGetUniformLocation(r->program, "u_scale");
+    glstate_useProgram(r->program);
+    glUniform1i(glGetUniformLocation(r->program, "u_tex"), 0);
+    glstate_useProgram(0);
+
+    static const unsigned char white[4] = {255, 255, 255, 255};
+    glGenTextures(1, &r->white);
+    glstate_bindTexture(GL_TEXTURE_2D, r->white);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+
+    GLsizeiptr size = (GLsizeiptr)REGION_VERTS * TSDL_RENDERER_REGIONS * sizeof(vertex);
+    glGenVertexArrays(1, &r->vao);
+    glGenBuffers(1, &r->vbo);
+    glstate_bindVertexArray(r->vao);
+    glstate_bindBuffer(GL_ARRAY_BUFFER, r->vbo);
+    r->persistent = has_buffer_storage();
+    if (r->persistent)
+    {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, size, NULL, flags);
+        r->base = glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+        if (!r->base)
+            r->persistent = TSDL_FALSE;
+    }
+    if (!r->persistent)
+    {
+        // buffer storage is immutable once set; start over with a mutable buffer
+        glstate_deleteBuffer(r->vbo);
+        glGenBuffers(1, &r->vbo);
+        glstate_bindBuffer(GL_ARRAY_BUFFER, r->vbo);
+        glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);
+    }
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(vertex), (void *)offsetof(vertex, x));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(vertex), (void *)offsetof(vertex, u));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(vertex), (void *)offsetof(vertex, c));
+    glstate_bindVertexArray(0);
+
+    LOG_STAT("Renderer created: persistent=%d regions=%d quads/region=%d",
+             r->persistent, TSDL_RENDERER_REGIONS, TSDL_RENDERER_MAX_QUADS);
+
+    return r;
+}
+void update_renderer(renderer r)
+{
+    if (!r)
+    {
+        log_error(TSDL_ERR, "Attempt to flush null renderer");
+        return;
+    }
+    if (!r->item_count)
+        return;
+
+    if (!r->persistent)
+    {
+        glstate_bindBuffer(GL_ARRAY_BUFFER, r->vbo);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
+
+    qsort(r->items, r->item_count, sizeof(batch_item), compare_items);
+
+    glstate_useProgram(r->program);
+    int w = 0, h = 0;
+    tsdl_getDrawableSize(r->win, &w, &h);
+    if (w != r->w || h != r->h)
+    {
+        glUniform2f(r->u_scale, w > 0 ? 2.0f / w : 0.0f, h > 0 ? -2.0f / h : 0.0f);
+        r->w = w;
+        r->h = h;
+    }
+    glstate_bindVertexArray(r->vao);
+    glstate_setBlend(GL_TRUE);
+    glstate_blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glstate_activeTexture(GL_TEXTURE0);
+
+    unsigned long draws = 0;
+    for (int i = 0; i < r->item_count;)
+    {
+        unsigned long long key = r->items[i].key;
+        int ranges = 0;
+        for (; i < r->item_count && r->items[i].key == key; i++, ranges++)
+        {
+            r->firsts[ranges] = r->items[i].first;
+            r->counts[ranges] = r->items[i].count;
+        }
+        glstate_bindTexture(GL_TEXTURE_2D, (GLuint)(key & 0xFFFFFFFFULL));
+        glMultiDrawArrays(GL_TRIANGLES, r->firsts, r->counts, ranges);
+        draws++;
+    }
+    glstate_bindVertexArray(0);
+
+    r->stats.quads = r->quads;
+    r->stats.items = r->item_count;
+    r->stats.draw_calls = draws;
+
+    r->fences[r->region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    r->region = (r->region + 1) % TSDL_RENDERER_REGIONS;
+    r->mapped = NULL;
+    r->quads = 0;
+    r->item_count = 0;
+}
+void destroy_renderer(renderer r)
+{
+    if (!r)
+    {
+        log_error(TSDL_ERR, "Attempt to destroy null renderer");
+        return;
+    }
+
+    for (int i = 0; i < TSDL_RENDERER_REGIONS; i++)
+    {
+        if (r->fences[i])
+            glDeleteSync(r->fences[i]);
+    }
+    if (r->vbo)
+    {
+        if (r->persistent || r->mapped)
+        {
+            glstate_bindBuffer(GL_ARRAY_BUFFER, r->vbo);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+        }
+        glstate_deleteBuffer(r->vbo);
+    }
+    if (r->vao)
+        glstate_deleteVertexArray(r->vao);
+    if (r->white)
+        glstate_deleteTexture(r->white);
+    if (r->program)
+        glstate_deleteProgram(r->program);
+    if (r->items)
+        Mem.free(r->items);
+    if (r->firsts)
+        Mem.free(r->firsts);
+    if (r->counts)
+        Mem.free(r->counts);
+    Mem.free(r);
+
+    LOG_STAT("Renderer destroyed");
+}
+void renderer_setLayer(renderer r, int layer)
+{
+    if (r)
+        r->layer = (unsigned long long)((unsigned int)layer ^ 0x80000000u) << 32;
+}
+void renderer_fillRect(renderer r, TSDL_Rect rect, TSDL_Color color)
+{
+    if (!r)
+        return;
+    vertex *v = push_quad(r, r->white);
+    if (!v)
+        return;
+
+    float xy[8] = {rect.x, rect.y, rect.x + rect.w, rect.y,
+                   rect.x + rect.w, rect.y + rect.h, rect.x, rect.y + rect.h};
+    write_quad(v, xy, (TSDL_Rect){0, 0, 1, 1}, color);
+}
+void renderer_drawRect(renderer r, TSDL_Rect rect, float thickness, TSDL_Color color)
+{
+    float t = thickness > 0.0f ? thickness : 1.0f;
+    renderer_fillRect(r, (TSDL_Rect){rect.x, rect.y, rect.w, t}, color);
+    renderer_fillRect(r, (TSDL_Rect){rect.x, rect.y + rect.h - t, rect.w, t}, color);
+    renderer_fillRect(r, (TSDL_Rect){rect.x, rect.y + t, t, rect.h - 2 * t}, color);
+    renderer_fillRect(r, (TSDL_Rect){rect.x + rect.w - t, rect.y + t, t, rect.h - 2 * t}, color);
+}
+void renderer_drawLine(renderer r, float x0, float y0, float x1, float y1, float thickness, TSDL_Color color)
+{
+    if (!r)
+        return;
+    float dx = x1 - x0, dy = y1 - y0;
+    float len = sqrtf(dx * dx + dy * dy);
+    if (len <= 0.0f)
+        return;
+    vertex *v = push_quad(r, r->white);
+    if (!v)
+        return;
+
+    // offset both ends by half the thickness along the normal
+    float half = (thickness > 0.0f ? thickness : 1.0f) * 0.5f;
+    float nx = -dy / len * half, ny = dx / len * half;
+    float xy[8] = {x0 + nx, y0 + ny, x1 + nx, y1 + ny,
+                   x1 - nx, y1 - ny, x0 - nx, y0 - ny};
+    write_quad(v, xy, (TSDL_Rect){0, 0, 1, 1}, color);
+}
+void renderer_drawTexture(renderer r, unsigned int texture, TSDL_Rect uv, TSDL_Rect dst, TSDL_Color tint)
+{
+    if (!r)
+        return;
+    vertex *v = push_quad(r, texture ? texture : r->white);
+    if (!v)
+        return;
+
+    float xy[8] = {dst.x, dst.y, dst.x + dst.w, dst.y,
+                   dst.x + dst.w, dst.y + dst.h, dst.x, dst.y + dst.h};
+    write_quad(v, xy, uv, tint);
+}
+TSDL_RendererStats renderer_getStats(renderer r)
+{
+    TSDL_RendererStats none = {0};
+    return r ? r->stats : none;
+}
@@ -0,0 +1,226 @@
+//  src/tsdl_thread.c
+
+/*
+    Render thread
+    =========================================================================
+
+    Optional mode where a dedicated thread owns the window's GL context.
+    The main thread keeps pumping events; clear/viewport/swap calls (and
+    arbitrary GL work via tsdl_runOnRenderThread) are pushed onto a
+    single-producer/single-consumer ring and executed in order on the
+    render thread, so a blocking vsync swap no longer holds up input.
+
+    The ring indices are the only shared state: the producer owns head,
+    the consumer owns tail. A semaphore wakes the consumer, and a second
+    one bounds how many swaps may be queued ahead of the display.
+ */
+
+#include "internal/tsdl_rendering.h"
+#include <pthread.h>
+#include <semaphore.h>
+#include <sched.h>
+#include <stdatomic.h>
+
+#define RENDER_RING 256 // Commands in flight (power of two)
+
+typedef enum
+{
+    RENDER_CLEAR,
+    RENDER_CLEAR_COLOR,
+    RENDER_VIEWPORT,
+    RENDER_SWAP,
+    RENDER_CALL,
+    RENDER_QUIT,
+} render_op;
+
+typedef struct
+{
+    render_op op; // Command
+    union
+    {
+        float color[4]; // RENDER_CLEAR_COLOR
+        int rect[4];    // RENDER_VIEWPORT
+        struct
+        {
+            TSDL_RenderCallback fn;
+            object user;
+        } call; // RENDER_CALL
+    };
+} render_cmd;
+
+static struct
+{
+    window win;                   // Window whose context the thread owns (NULL = off)
+    pthread_t thread;             // Render thread
+    render_cmd ring[RENDER_RING]; // Command ring
+    _Atomic unsigned int head;    // Next slot to write (producer)
+    _Atomic unsigned int tail;    // Next slot to read (consumer)
+    sem_t pending;                // Commands available to the consumer
+    sem_t frames;                 // Swaps the producer may still queue
+} render = {0};
+static _Thread_local int is_render_thread = TSDL_FALSE;
+
+// Render Thread Helpers ======================================================
+static int on_render_thread(void)
+{
+    return is_render_thread;
+}
+static void push(const render_cmd *cmd)
+{
+    unsigned int head = atomic_load_explicit(&render.head, memory_order_relaxed);
+    while (head - atomic_load_explicit(&render.tail, memory_order_acquire) >= RENDER_RING)
+        sched_yield(); // ring full; the render thread is a whole ring behind
+
+    render.ring[head & (RENDER_RING - 1)] = *cmd;
+    atomic_store_explicit(&render.head, head + 1, memory_order_release);
+    sem_post(&render.pending);
+}
+static void *render_main(object arg)
+{
+    window win = arg;
+    is_render_thread = TSDL_TRUE;
+    tsdl_makeCurrent(win);
+
+    for (int running = TSDL_TRUE; running;)
+    {
+        while (sem_wait(&render.pending) != 0)
+            ; // EINTR
+
+        unsigned int tail = atomic_load_explicit(&render.tail, memory_order_relaxed);
+        render_cmd cmd = render.ring[tail & (RENDER_RING - 1)];
+        atomic_store_explicit(&render.tail, tail + 1, memory_order_release);
+
+        switch (cmd.op)
+        {
+        case RENDER_CLEAR:
+            tsdl_clear(win);
+            break;
+        case RENDER_CLEAR_COLOR:
+            tsdl_clearColor(win, cmd.color[0], cmd.color[1], cmd.color[2], cmd.color[3]);
+            break;
+        case RENDER_VIEWPORT:
+            tsdl_setViewport(win, cmd.rect[0], cmd.rect[1], cmd.rect[2], cmd.rect[3]);
+            break;
+        case RENDER_SWAP:
+            tsdl_swapBuffers(win);
+            sem_post(&render.frames);
+            break;
+        case RENDER_CALL:
+            cmd.call.fn(cmd.call.user);
+            break;
+        case RENDER_QUIT:
+            running = TSDL_FALSE;
+            break;
+        }
+    }
+
+    tsdl_releaseCurrent(win);
+
+    return NULL;
+}
+
+// Render Thread Functions ====================================================
+int tsdl_startRenderThread(window win, int frames)
+{
+    if (!win)
+        return log_error(TSDL_ERR_WINDOW, "Attempt to start render thread on null window");
+    if (render.win)
+        return log_error(TSDL_ERR, "Render thread already running");
+
+    atomic_store(&render.head, 0);
+    atomic_store(&render.tail, 0);
+    sem_init(&render.pending, 0, 0);
+    sem_init(&render.frames, 0, frames > 0 ? frames : 1);
+
+    // the context can only be current on one thread at a time
+    tsdl_releaseCurrent(win);
+    render.win = win;
+    if (pthread_create(&render.thread, NULL, render_main, win) != 0)
+    {
+        render.win = NULL;
+        sem_destroy(&render.pending);
+        sem_destroy(&render.frames);
+        tsdl_makeCurrent(win);
+        return log_error(TSDL_ERR, "Failed to create render thread");
+    }
+
+    LOG_STAT("Render thread started (frames in flight=%d)", frames > 0 ? frames : 1);
+
+    return TSDL_ERR_NONE;
+}
+void tsdl_stopRenderThread(window win)
+{
+    if (!render.win || render.win != win || on_render_thread())
+        return;
+
+    render_cmd cmd = {.op = RENDER_QUIT};
+    push(&cmd);
+    pthread_join(render.thread, NULL);
+
+    render.win = NULL;
+    sem_destroy(&render.pending);
+    sem_destroy(&render.frames);
+    tsdl_makeCurrent(win);
+
+    LOG_STAT("Render thread stopped");
+}
+void tsdl_runOnRenderThread(TSDL_RenderCallback fn, object user)
+{
+    if (!fn)
+        return;
+    if (!render.win || on_render_thread())
+    {
+        fn(user);
+        return;
+    }
+
+    render_cmd cmd = {.op = RENDER_CALL, .call = {fn, user}};
+    push(&cmd);
+}
+int render_thread_owns(window win)
+{
+    return win && render.win == win;
+}
+int render_thread_clear(window win)
+{
+    if (!render_thread_owns(win) || on_render_thread())
+        return TSDL_FALSE;
+
+    render_cmd cmd = {.op = RENDER_CLEAR};
+    push(&cmd);
+
+    return TSDL_TRUE;
+}
+int render_thread_clearColor(window win, float r, float g, float b, float a)
+{
+    if (!render_thread_owns(win) || on_render_thread())
+        return TSDL_FALSE;
+
+    render_cmd cmd = {.op = RENDER_CLEAR_COLOR, .color = {r, g, b, a}};
+    push(&cmd);
+
+    return TSDL_TRUE;
+}
+int render_thread_viewport(window win, int x, int y, int w, int h)
+{
+    if (!render_thread_owns(win) || on_render_thread())
+        return TSDL_FALSE;
+
+    render_cmd cmd = {.op = RENDER_VIEWPORT, .rect = {x, y, w, h}};
+    push(&cmd);
+
+    return TSDL_TRUE;
+}
+int render_thread_swap(window win)
+{
+    if (!render_thread_owns(win) || on_render_thread())
+        return TSDL_FALSE;
+
+    // block only when `frames` swaps are already queued ahead of the display
+    while (sem_wait(&render.frames) != 0)
+        ; // EINTR
+    render_cmd cmd = {.op = RENDER_SWAP};
+    push(&cmd);
+
+    return TSDL_TRUE;
+}
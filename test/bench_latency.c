@@ -0,0 +1,227 @@
+//	bench_latency.c
+//
+//	Input-to-present latency benchmark.
+//
+//	X11 build: a second display connection injects mouse clicks with XTest at random points
+//	in the frame. Each click flips the clear color, and the frame counts as presented once a
+//	front-buffer readback shows the new color. Runs under Xvfb when there is no display.
+//
+//	Mock build (TSDL_MOCK): clicks are posted with pushEvent and timed to delivery, which
+//	measures the event path on its own.
+//
+//	usage: bench_latency [samples] [max p99 ms]; exits 1 when p99 is over the limit
+#include "tinysdl.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#ifndef TSDL_MOCK
+#include "../src/internal/tsdl_gl.h"
+#include "../src/internal/tsdl_rendering.h"
+#include <GL/glx.h>
+#include <X11/Xlib.h>
+#include <X11/extensions/XTest.h>
+#endif
+
+#define BENCH_W 320
+#define BENCH_H 240
+#define DEFAULT_SAMPLES 200
+#define SAMPLE_TIMEOUT 1.0 // Seconds before a sample counts as lost
+
+static struct
+{
+	_Atomic double sent;  // When the pending click was injected (0 = none pending)
+	_Atomic int running;  // Injector keeps going
+	int samples;          // Clicks to inject
+#ifndef TSDL_MOCK
+	Window target;        // The bench window, clicked at its centre
+#endif
+} bench = {0};
+
+static double now_seconds(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+static int compare(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+#ifndef TSDL_MOCK
+//	move the pointer to the window's centre; a window manager may have placed or moved it anywhere
+static void aim(Display *display)
+{
+	Window child;
+	int x, y;
+	if (XTranslateCoordinates(display, bench.target, DefaultRootWindow(display), BENCH_W / 2, BENCH_H / 2, &x, &y, &child))
+		XTestFakeMotionEvent(display, -1, x, y, CurrentTime);
+}
+#endif
+//	one click at a time, each at a random point in the frame so vblank phase is sampled evenly
+static void *inject(object arg)
+{
+#ifndef TSDL_MOCK
+	Display *display = arg;
+	//	clicks before the window is mapped would land on whatever is underneath
+	XWindowAttributes attributes = {0};
+	while (atomic_load(&bench.running) && XGetWindowAttributes(display, bench.target, &attributes) &&
+		   attributes.map_state != IsViewable)
+		usleep(10000);
+#endif
+	for (int i = 0; i < bench.samples && atomic_load(&bench.running); i++)
+	{
+		usleep(20000 + rand() % 20000);
+#ifndef TSDL_MOCK
+		aim(display);
+#endif
+		while (atomic_load(&bench.sent) != 0 && atomic_load(&bench.running))
+			usleep(1000);
+
+		atomic_store(&bench.sent, now_seconds());
+#ifdef TSDL_MOCK
+		TSDL_Event click = {.type = TSDL_EVENT_MOUSE_BUTTON_DOWN};
+		click.data.mouse_button.button = 0; // Left
+		TinySDL.pushEvent(&click);
+#else
+		XTestFakeButtonEvent(display, 1, True, CurrentTime);
+		XTestFakeButtonEvent(display, 1, False, CurrentTime);
+		XFlush(display);
+#endif
+	}
+
+	return NULL;
+}
+#ifndef TSDL_MOCK
+//	TSDL_TRUE once the front buffer shows the frame drawn for this click
+static int presented(int red)
+{
+	unsigned char pixel[4];
+	glReadBuffer(GL_FRONT);
+	glReadPixels(BENCH_W / 2, BENCH_H / 2, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+
+	return red ? pixel[0] > 128 && pixel[1] < 128 : pixel[0] < 128 && pixel[1] > 128;
+}
+#endif
+
+int main(int argc, char **argv)
+{
+	bench.samples = argc > 1 ? atoi(argv[1]) : DEFAULT_SAMPLES;
+	double max_p99 = argc > 2 ? atof(argv[2]) : 0;
+	if (bench.samples <= 0)
+		bench.samples = DEFAULT_SAMPLES;
+
+	if (TinySDL.init_video() != 0)
+	{
+		fprintf(stderr, "init failed: %s\n", TinySDL.getError());
+		return 1;
+	}
+	window win = TinySDL.window->create("latency", 0, 0, BENCH_W, BENCH_H, TSDL_WINDOW_SHOWN);
+	if (!win)
+	{
+		fprintf(stderr, "window failed: %s\n", TinySDL.getError());
+		TinySDL.quit();
+		return 1;
+	}
+
+	object injector_arg = NULL;
+#ifndef TSDL_MOCK
+	int event, error, major, minor;
+	Display *injector_display = XOpenDisplay(NULL);
+	if (!injector_display || !XTestQueryExtension(injector_display, &event, &error, &major, &minor))
+	{
+		fprintf(stderr, "XTest unavailable\n");
+		TinySDL.window->destroy(win);
+		TinySDL.quit();
+		return 1;
+	}
+	injector_arg = injector_display;
+	bench.target = glXGetCurrentDrawable(); // the window's context is current after create
+#endif
+
+	double *latency = malloc(sizeof(double) * bench.samples);
+	int count = 0, lost = 0;
+	pthread_t injector;
+	atomic_store(&bench.running, TSDL_TRUE);
+	pthread_create(&injector, NULL, inject, injector_arg);
+
+	while (count + lost < bench.samples)
+	{
+		int clicked = TSDL_FALSE;
+		TSDL_Event ev;
+#ifdef TSDL_MOCK
+		//	no frames to wait for; delivery is the end point
+		clicked = TinySDL.waitEvent(&ev, 100) && ev.type == TSDL_EVENT_MOUSE_BUTTON_DOWN;
+		double sent = atomic_load(&bench.sent);
+		if (clicked)
+			latency[count++] = now_seconds() - sent;
+#else
+		static int red = TSDL_FALSE;
+		tsdl_beginFrame(win);
+		while (TinySDL.pollEvent(&ev))
+			clicked |= ev.type == TSDL_EVENT_MOUSE_BUTTON_DOWN;
+		if (clicked)
+			red = !red;
+		tsdl_clearColor(win, red ? 1.0f : 0.0f, red ? 0.0f : 1.0f, 0.0f, 1.0f);
+		tsdl_clear(win);
+		tsdl_endFrame(win);
+
+		double sent = atomic_load(&bench.sent);
+		//	the swap may return before scan-out; the readback is what the user would see
+		while (clicked && !presented(red) && now_seconds() - sent < SAMPLE_TIMEOUT)
+			usleep(100);
+		if (clicked)
+			latency[count++] = now_seconds() - sent;
+#endif
+		if (clicked)
+		{
+			atomic_store(&bench.sent, 0);
+		}
+		else if (sent != 0 && now_seconds() - sent > SAMPLE_TIMEOUT)
+		{
+			lost++;
+			atomic_store(&bench.sent, 0);
+		}
+	}
+	atomic_store(&bench.running, TSDL_FALSE);
+	pthread_join(injector, NULL);
+
+	int status = 0;
+	if (count > 0)
+	{
+		qsort(latency, count, sizeof(double), compare);
+		double p50 = latency[count / 2] * 1000.0;
+		double p99 = latency[count * 99 / 100] * 1000.0;
+		printf("%s latency over %d samples (%d lost): p50 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+#ifdef TSDL_MOCK
+			   "input-to-delivery",
+#else
+			   "input-to-present",
+#endif
+			   count, lost, p50, p99, latency[count - 1] * 1000.0);
+		if (max_p99 > 0 && p99 > max_p99)
+		{
+			printf("p99 over the %.2f ms limit\n", max_p99);
+			status = 1;
+		}
+	}
+	else
+	{
+		printf("no samples arrived\n");
+		status = 1;
+	}
+
+	free(latency);
+#ifndef TSDL_MOCK
+	XCloseDisplay(injector_display);
+#endif
+	TinySDL.window->destroy(win);
+	TinySDL.quit();
+
+	return status;
+}
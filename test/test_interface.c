@@ -1,7 +1,13 @@
 //	test_interface.c
 #include "tinysdl.h"
 #include <sigtest.h>
+#include <linux/input.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 // Assert.isTrue(condition, "fail message");
@@ -24,14 +30,14 @@ void test_window_create(void)
 	fflush(stdout);
 
 	// 	test init
-	Assert.isTrue(TinySDL.init_video(TSDL_INIT_VIDEO) == 0, "TinySDL init failed");
+	Assert.isTrue(TinySDL.init_video() == 0, "TinySDL init failed");
 
 	//	test createWindow
-	window win = TinySDL.createWindow("TinySDL Window", 0, 0, 800, 600, TSDL_WINDOW_SHOWN);
+	window win = TinySDL.window->create("TinySDL Window", 0, 0, 800, 600, TSDL_WINDOW_SHOWN);
 	Assert.isTrue(win != NULL, "TinySDL createWindow failed");
 
 	//	test window destruction
-	TinySDL.destroyWindow(win);
+	TinySDL.window->destroy(win);
 
 	//	test quit
 	TinySDL.quit();
@@ -43,7 +49,7 @@ void test_window_destroy_null(void)
 	fflush(stdout);
 
 	//	test destroy null window
-	TinySDL.destroyWindow(NULL);
+	TinySDL.window->destroy(NULL);
 }
 //	test event polling
 void test_event_polling(void)
@@ -51,15 +57,436 @@ void test_event_polling(void)
 	printf("\n");
 	fflush(stdout);
 
-	Assert.isTrue(TinySDL.init_video(TSDL_INIT_VIDEO) == 0, "TinySDL init failed");
-	window win = TinySDL.createWindow("TinySDL Window", 0, 0, 800, 600, TSDL_WINDOW_SHOWN);
+	Assert.isTrue(TinySDL.init_video() == 0, "TinySDL init failed");
+	window win = TinySDL.window->create("TinySDL Window", 0, 0, 800, 600, TSDL_WINDOW_SHOWN);
 	Assert.isTrue(win != NULL, "TinySDL createWindow failed");
 
 	TSDL_Event event;
 	sleep(1);
 	Assert.isTrue(TinySDL.pollEvent(&event) >= 0, "TinySDL pollEvent failed");
 
-	TinySDL.destroyWindow(win);
+	TinySDL.window->destroy(win);
+	TinySDL.quit();
+}
+//	post user events from worker threads and wait for them on the main thread
+#define POST_THREADS 4
+#define POST_COUNT 1000
+static void *post_events(void *arg)
+{
+	TSDL_Event event = {.type = TSDL_EVENT_USER};
+	event.data.user.code = (int)(long)arg;
+	for (int i = 0; i < POST_COUNT;)
+	{
+		event.data.user.data1 = (object)(long)i;
+		if (TinySDL.pushEvent(&event))
+			i++;
+	}
+
+	return NULL;
+}
+void test_push_event(void)
+{
+	printf("\n");
+	fflush(stdout);
+
+	Assert.isTrue(TinySDL.init_video() == 0, "TinySDL init failed");
+	window win = TinySDL.window->create("TinySDL Window", 0, 0, 800, 600, TSDL_WINDOW_SHOWN);
+	Assert.isTrue(win != NULL, "TinySDL window create failed");
+
+	pthread_t threads[POST_THREADS];
+	for (long i = 0; i < POST_THREADS; i++)
+	{
+		pthread_create(&threads[i], NULL, post_events, (void *)i);
+	}
+
+	//	events from one thread arrive in the order they were posted
+	long next[POST_THREADS] = {0};
+	int received = 0, ordered = 1;
+	TSDL_Event event;
+	while (received < POST_THREADS * POST_COUNT && TinySDL.waitEvent(&event, 1000))
+	{
+		if (event.type != TSDL_EVENT_USER)
+			continue;
+		int code = event.data.user.code;
+		ordered &= (long)event.data.user.data1 == next[code];
+		next[code] = (long)event.data.user.data1 + 1;
+		received++;
+	}
+	for (int i = 0; i < POST_THREADS; i++)
+	{
+		pthread_join(threads[i], NULL);
+	}
+	Assert.isTrue(received == POST_THREADS * POST_COUNT, "Posted events were lost");
+	Assert.isTrue(ordered, "Posted events were reordered");
+
+	//	nothing posted: the wait times out
+	Assert.isFalse(TinySDL.waitEvent(&event, 50) && event.type == TSDL_EVENT_USER, "Unexpected user event");
+
+	TinySDL.window->destroy(win);
+	TinySDL.quit();
+}
+//	filter drops or rewrites events before they are queued; watches only observe
+static int drop_odd_codes(object user, TSDL_Event *event)
+{
+	if (event->type != TSDL_EVENT_USER)
+		return TSDL_TRUE;
+	if (event->data.user.code & 1)
+		return TSDL_FALSE;
+	event->data.user.code *= 10;
+
+	return TSDL_TRUE;
+}
+static int count_events(object user, TSDL_Event *event)
+{
+	if (event->type == TSDL_EVENT_USER)
+		(*(int *)user)++;
+	event->data.user.code = -1; //	ignored: watches see a copy
+
+	return TSDL_FALSE;
+}
+void test_event_filter(void)
+{
+	printf("\n");
+	fflush(stdout);
+
+	Assert.isTrue(TinySDL.init_video() == 0, "TinySDL init failed");
+
+	int watched = 0;
+	TinySDL.setEventFilter(drop_odd_codes, NULL);
+	Assert.isTrue(TinySDL.addEventWatch(count_events, &watched) == 0, "Event watch add failed");
+
+	TSDL_Event event = {.type = TSDL_EVENT_USER};
+	for (int i = 0; i < 10; i++)
+	{
+		event.data.user.code = i;
+		TinySDL.pushEvent(&event);
+	}
+
+	int received = 0, rewritten = 1;
+	while (TinySDL.pollEvent(&event))
+	{
+		if (event.type != TSDL_EVENT_USER)
+			continue;
+		rewritten &= event.data.user.code % 20 == 0;
+		received++;
+	}
+	Assert.isTrue(received == 5, "Filter should drop odd codes");
+	Assert.isTrue(rewritten, "Filter should rewrite queued events");
+	Assert.isTrue(watched == 5, "Watch should see each event that passed the filter");
+
+	TinySDL.removeEventWatch(count_events, &watched);
+	TinySDL.setEventFilter(NULL, NULL);
+	TinySDL.quit();
+}
+//	disabled event types are not delivered
+void test_event_state(void)
+{
+	printf("\n");
+	fflush(stdout);
+
+	Assert.isTrue(TinySDL.init_video() == 0, "TinySDL init failed");
+	window win = TinySDL.window->create("TinySDL Window", 0, 0, 800, 600, TSDL_WINDOW_SHOWN);
+	Assert.isTrue(win != NULL, "TinySDL window create failed");
+
+	Assert.isTrue(TinySDL.eventState(TSDL_EVENT_MOUSE_MOVED, TSDL_QUERY), "Events should start enabled");
+	Assert.isTrue(TinySDL.eventState(TSDL_EVENT_MOUSE_MOVED, TSDL_FALSE), "Disable should report the previous state");
+	Assert.isFalse(TinySDL.eventState(TSDL_EVENT_MOUSE_MOVED, TSDL_QUERY), "Event type should be disabled");
+
+	TSDL_Event event = {.type = TSDL_EVENT_MOUSE_MOVED};
+	TinySDL.pushEvent(&event);
+	int moved = 0;
+	while (TinySDL.pollEvent(&event))
+	{
+		moved += event.type == TSDL_EVENT_MOUSE_MOVED;
+	}
+	Assert.isTrue(moved == 0, "Disabled event type was delivered");
+
+	TinySDL.eventState(TSDL_EVENT_MOUSE_MOVED, TSDL_TRUE);
+	TinySDL.window->destroy(win);
+	TinySDL.quit();
+}
+//	drop payloads are packed into a single block of string views
+void test_drop_payload(void)
+{
+	printf("\n");
+	fflush(stdout);
+
+	const char *paths[] = {"/tmp/a.txt", "", "/home/user/some file.png"};
+	TSDL_Event event = {.type = TSDL_EVENT_DROP};
+	event.data.drop.paths = copy_drop_paths(3, paths);
+	event.data.drop.count = 3;
+	Assert.isTrue(event.data.drop.paths != NULL, "Drop payload allocation failed");
+
+	const TSDL_StringView *views = event.data.drop.paths;
+	for (int i = 0; i < 3; i++)
+	{
+		Assert.isTrue(views[i].len == strlen(paths[i]), "Drop path length mismatch");
+		Assert.isTrue(strcmp(views[i].str, paths[i]) == 0, "Drop path copy mismatch");
+	}
+	//	strings follow the view table back to back
+	Assert.isTrue(views[0].str == (const char *)(views + 3), "Drop strings should follow the view table");
+	Assert.isTrue(views[2].str == views[1].str + views[1].len + 1, "Drop strings should be packed");
+
+	clear_drop_paths(&event);
+	Assert.isTrue(event.data.drop.paths == NULL && event.data.drop.count == 0, "Drop payload not cleared");
+}
+//	test per-thread error records
+static void *error_thread(void *arg)
+{
+	TinySDL.pushEvent(NULL);
+	return NULL;
+}
+void test_error_ring(void)
+{
+	printf("\n");
+	fflush(stdout);
+
+	TinySDL.clearError();
+	Assert.isTrue(TinySDL.lastError() == NULL, "Cleared thread should have no error");
+	Assert.isTrue(TinySDL.getError()[0] == '\0', "Cleared thread should format no text");
+
+	Assert.isFalse(TinySDL.pushEvent(NULL), "Posting NULL should fail");
+	const TSDL_ErrorRecord *record = TinySDL.lastError();
+	Assert.isTrue(record != NULL && record->code == TSDL_ERR, "Error record missing");
+	Assert.isTrue(strcmp(record->msg, "Attempt to post an empty event") == 0, "Error message mismatch");
+	Assert.isTrue(record->file != NULL && record->line > 0, "Error location missing");
+	Assert.isTrue(strstr(TinySDL.getError(), record->msg) != NULL, "getError should include the record");
+
+	//	overflow keeps the newest records and stays within bounds
+	for (int i = 0; i < TSDL_ERROR_RING * 2; i++)
+		TinySDL.pushEvent(NULL);
+	Assert.isTrue(strlen(TinySDL.getError()) < TSDL_ERROR_SIZE, "Formatted errors overflowed");
+	Assert.isTrue(TinySDL.lastError() != NULL, "Newest record lost on overflow");
+
+	//	another thread's errors stay on that thread
+	TinySDL.clearError();
+	pthread_t thread;
+	pthread_create(&thread, NULL, error_thread, NULL);
+	pthread_join(thread, NULL);
+	Assert.isTrue(TinySDL.lastError() == NULL, "Errors leaked across threads");
+}
+//	test event recording and replay
+void test_record_replay(void)
+{
+	printf("\n");
+	fflush(stdout);
+
+	const char *log = "/tmp/tinysdl_test.tsdlrec";
+	Assert.isTrue(TinySDL.init_video() == 0, "TinySDL init failed");
+	Assert.isTrue(TinySDL.recordEvents(log) == TSDL_ERR_NONE, "Recording failed to start");
+
+	TSDL_Event sent[3] = {
+		{.type = TSDL_EVENT_KEY_DOWN, .data.key = {.keycode = TSDL_KEY_F1, .mods = TSDL_MOD_LSHIFT}},
+		{.type = TSDL_EVENT_MOUSE_MOVED, .data.mouse_moved = {.x = -5, .y = 700}},
+		{.type = TSDL_EVENT_MOUSE_WHEEL, .data.mouse_wheel = {.xoffset = 0.25, .yoffset = -1.5}},
+	};
+	for (int i = 0; i < 3; i++)
+		TinySDL.pushEvent(&sent[i]);
+
+	TSDL_Event event;
+	while (TinySDL.pollEvent(&event))
+		;
+	TinySDL.recordEvents(NULL);
+
+	//	replay as fast as polled; the same stream comes back
+	Assert.isTrue(TinySDL.replayEvents(log, 0) == TSDL_ERR_NONE, "Replay failed to start");
+	TSDL_Event replayed[4];
+	int received = 0;
+	while (received < 4 && TinySDL.pollEvent(&replayed[received]))
+		received++;
+	Assert.isTrue(received == 3, "Replay should deliver every recorded event");
+	for (int i = 0; i < 3; i++)
+		Assert.isTrue(replayed[i].type == sent[i].type, "Replayed event type mismatch");
+	Assert.isTrue(replayed[0].data.key.keycode == TSDL_KEY_F1 && replayed[0].data.key.mods == TSDL_MOD_LSHIFT, "Replayed key mismatch");
+	Assert.isTrue(replayed[1].data.mouse_moved.x == -5 && replayed[1].data.mouse_moved.y == 700, "Replayed motion mismatch");
+	Assert.isTrue(replayed[2].data.mouse_wheel.yoffset == -1.5, "Replayed wheel mismatch");
+
+	TinySDL.quit();
+	unlink(log);
+}
+//	test joysticks against a FIFO standing in for an evdev node
+void test_joystick_stand_in(void)
+{
+	printf("\n");
+	fflush(stdout);
+
+	char dir[] = "/tmp/tinysdl_evdev_XXXXXX";
+	Assert.isTrue(mkdtemp(dir) != NULL, "Failed to create evdev directory");
+	char node[64];
+	snprintf(node, sizeof(node), "%s/event0", dir);
+	setenv("TSDL_EVDEV_DIR", dir, 1);
+
+	Assert.isTrue(TinySDL.init_video() == 0, "TinySDL init failed");
+	Assert.isTrue(TinySDL.init(TSDL_INIT_JOYSTICK) == TSDL_ERR_NONE, "Joystick init failed");
+
+	//	plugged in after init; hot-plug picks it up
+	Assert.isTrue(mkfifo(node, 0600) == 0, "Failed to create stand-in node");
+	TSDL_Event event;
+	int added = TSDL_FALSE;
+	for (int i = 0; i < 100 && !added; i++)
+		added = TinySDL.pollEvent(&event) && event.type == TSDL_EVENT_JOY_ADDED;
+	Assert.isTrue(added && event.data.joy_device.which == 0, "Stand-in joystick not added");
+
+	int fd = open(node, O_WRONLY | O_NONBLOCK);
+	struct input_event input[3] = {
+		{.type = EV_KEY, .code = BTN_SOUTH, .value = 1},
+		{.type = EV_ABS, .code = ABS_X, .value = 32767},
+		{.type = EV_SYN, .code = SYN_REPORT},
+	};
+	Assert.isTrue(write(fd, input, sizeof(input)) == sizeof(input), "Failed to feed stand-in node");
+
+	int pressed = TSDL_FALSE, moved = TSDL_FALSE;
+	while (TinySDL.pollEvent(&event))
+	{
+		if (event.type == TSDL_EVENT_JOY_BUTTON_DOWN)
+			pressed = event.data.joy_button.button == 0;
+		if (event.type == TSDL_EVENT_JOY_AXIS)
+			moved = event.data.joy_axis.axis == 0 && event.data.joy_axis.value == 1.0f;
+	}
+	Assert.isTrue(pressed, "Button press not delivered");
+	Assert.isTrue(moved, "Axis motion not delivered");
+
+	TSDL_JoystickState state;
+	Assert.isTrue(TinySDL.getJoystickState(0, &state), "Joystick should report connected");
+	Assert.isTrue((state.buttons & 1) && state.axes[0] == 1.0f, "Polled state out of date");
+
+	//	unplugged; the slot empties
+	close(fd);
+	unlink(node);
+	int removed = TSDL_FALSE;
+	for (int i = 0; i < 100 && !removed; i++)
+		removed = TinySDL.pollEvent(&event) && event.type == TSDL_EVENT_JOY_REMOVED;
+	Assert.isTrue(removed, "Stand-in joystick not removed");
+	Assert.isFalse(TinySDL.getJoystickState(0, &state), "Removed joystick still connected");
+
+	TinySDL.quit();
+	rmdir(dir);
+	unsetenv("TSDL_EVDEV_DIR");
+}
+//	test text batching: whole code points, split across inline-sized events
+void test_text_batching(void)
+{
+	printf("\n");
+	fflush(stdout);
+
+	const char *typed = "caf\xC3\xA9 \xE2\x82\xAC" "5 \xF0\x9F\x98\x80 na\xC3\xAFve r\xC3\xA9sum\xC3\xA9 \xE2\x82\xAC\xE2\x82\xAC";
+	int len = (int)strlen(typed), taken = 0, events = 0;
+	char joined[128] = "";
+	while (taken < len)
+	{
+		TSDL_Event text = {.type = TSDL_EVENT_NONE};
+		int n = append_text(&text, typed + taken, len - taken);
+		Assert.isTrue(n > 0, "No progress appending text");
+		Assert.isTrue(text.type == TSDL_EVENT_TEXT_INPUT, "Text event type not set");
+		Assert.isTrue(strlen(text.data.text.text) < TSDL_TEXT_INPUT_SIZE, "Text overran the inline buffer");
+		Assert.isTrue(((unsigned char)typed[taken + n] & 0xC0) != 0x80, "Text split inside a code point");
+		strcat(joined, text.data.text.text);
+		taken += n;
+		events++;
+	}
+	Assert.isTrue(strcmp(joined, typed) == 0, "Batched text lost characters");
+	Assert.isTrue(events == 2, "Text should fill each event before starting another");
+
+	//	code points encode to the same bytes the backends deliver
+	char utf8[4];
+	Assert.isTrue(utf8_encode(0x20AC, utf8) == 3 && memcmp(utf8, "\xE2\x82\xAC", 3) == 0, "Euro sign misencoded");
+	Assert.isTrue(utf8_encode(0x1F600, utf8) == 4, "Astral code point misencoded");
+	Assert.isTrue(utf8_encode(0xD800, utf8) == 0, "Surrogate half encoded");
+
+	//	a truncated sequence is dropped rather than stalling the caller
+	TSDL_Event text = {.type = TSDL_EVENT_NONE};
+	Assert.isTrue(append_text(&text, "ab\xE2\x82", 4) == 4 && strcmp(text.data.text.text, "ab") == 0, "Truncated sequence kept");
+}
+//	test window state: transitions reported once, windowed geometry kept across fullscreen
+void test_window_state(void)
+{
+	printf("\n");
+	fflush(stdout);
+
+	TSDL_WindowTracker track;
+	TSDL_Event event = {.type = TSDL_EVENT_NONE};
+	track_init(&track, 10, 20, 640, 480, TSDL_WINDOW_RESIZABLE);
+
+	//	the first map is not a restore
+	track.visible = TSDL_TRUE;
+	Assert.isFalse(track_state(&track, &event), "First map reported a transition");
+
+	//	unmap + iconify + map collapses to one minimize and one restore
+	track.visible = TSDL_FALSE;
+	Assert.isFalse(track_state(&track, &event), "Unmap alone reported a transition");
+	track.minimized = TSDL_TRUE;
+	Assert.isTrue(track_state(&track, &event) && event.type == TSDL_EVENT_WINDOW_MINIMIZED, "Iconify not reported");
+	Assert.isFalse(track_state(&track, &event), "Duplicate minimize reported");
+	track.minimized = TSDL_FALSE;
+	track.visible = TSDL_TRUE;
+	Assert.isTrue(track_state(&track, &event) && event.type == TSDL_EVENT_WINDOW_RESTORED, "Restore not reported");
+
+	//	geometry only emits when it changes
+	Assert.isFalse(track_geometry(&track, 10, 20, 640, 480, &event), "Unchanged geometry reported");
+	Assert.isTrue(track_geometry(&track, 30, 40, 640, 480, &event) && event.type == TSDL_EVENT_WINDOW_MOVED, "Move not reported");
+	Assert.isTrue(track_geometry(&track, 30, 40, 800, 600, &event) && event.type == TSDL_EVENT_WINDOW_RESIZED, "Resize not reported");
+
+	//	fullscreen geometry doesn't overwrite the windowed geometry
+	track.fullscreen = TSDL_TRUE;
+	track_state(&track, &event);
+	Assert.isTrue(track_geometry(&track, 0, 0, 1920, 1080, &event) && event.data.window_resized.is_fullscreen, "Fullscreen resize not flagged");
+	Assert.isTrue(track.normal.w == 800 && track.normal.h == 600 && track.normal.x == 30, "Restore geometry overwritten");
+	track.fullscreen = TSDL_FALSE;
+	Assert.isTrue(track_state(&track, &event) && event.type == TSDL_EVENT_WINDOW_RESTORED, "Leaving fullscreen not reported");
+
+	//	minimized or fully covered windows can't be seen
+	Assert.isTrue(track_visible(&track), "Shown window not visible");
+	track.occluded = TSDL_TRUE;
+	Assert.isFalse(track_visible(&track), "Occluded window visible");
+}
+//	next display event; the window's own events (focus, expose, move) depend on the window manager
+static int poll_display(TSDL_Event *event)
+{
+	while (TinySDL.pollEvent(event))
+	{
+		if (display_event(event->type))
+			return TSDL_TRUE;
+	}
+
+	return TSDL_FALSE;
+}
+//	test displays: slots stay put across hot-plugs; only real differences are reported
+void test_display_hotplug(void)
+{
+	printf("\n");
+	fflush(stdout);
+
+	Assert.isTrue(TinySDL.init_video() == 0, "TinySDL init failed");
+	window win = TinySDL.window->create("TinySDL Window", 0, 0, 800, 600, TSDL_WINDOW_SHOWN);
+	Assert.isTrue(win != NULL, "TinySDL window create failed");
+
+	//	the starting layout is there to query, without events
+	TSDL_DisplayInfo info;
+	TSDL_Event event;
+	Assert.isTrue(TinySDL.getDisplay(0, &info) && info.primary && info.refresh > 0, "Starting display missing");
+	Assert.isTrue(TinySDL.window->getDisplay(win) == 0, "Window not on the starting display");
+	Assert.isFalse(poll_display(&event), "Starting layout reported");
+
+	//	plug a 144 Hz panel to the right
+	TSDL_DisplayInfo layout[2] = {info, {.x = info.w, .w = 2560, .h = 1440, .refresh = 144.0, .scale = 1.0f, .name = "DP-2"}};
+	display_update(layout, 2);
+	Assert.isTrue(poll_display(&event) && event.type == TSDL_EVENT_DISPLAY_ADDED && event.data.display.which == 1, "Plug not reported");
+	Assert.isTrue(display_at(info.w + 100, 100) == 1 && TinySDL.getDisplay(1, &info) && info.refresh == 144.0, "Point not on the new display");
+
+	//	same layout again: nothing; a mode change on the second: changed
+	display_update(layout, 2);
+	Assert.isFalse(poll_display(&event), "Unchanged layout reported");
+	layout[1].refresh = 120.0;
+	display_update(layout, 2);
+	Assert.isTrue(poll_display(&event) && event.type == TSDL_EVENT_DISPLAY_CHANGED && event.data.display.which == 1, "Mode change not reported");
+
+	//	unplugging the first keeps the second in its slot
+	display_update(&layout[1], 1);
+	Assert.isTrue(poll_display(&event) && event.type == TSDL_EVENT_DISPLAY_REMOVED && event.data.display.which == 0, "Unplug not reported");
+	Assert.isFalse(TinySDL.getDisplay(0, &info), "Removed display still connected");
+	Assert.isTrue(TinySDL.getDisplay(1, &info) && strcmp(info.name, "DP-2") == 0, "Remaining display moved slots");
+
+	TinySDL.window->destroy(win);
 	TinySDL.quit();
 }
 
@@ -70,4 +497,14 @@ __attribute__((constructor)) void init_sigtest_tests(void)
 	register_test("test_window_create", test_window_create);
 	register_test("test_window_destroy_null", test_window_destroy_null);
 	register_test("test_event_polling", test_event_polling);
+	register_test("test_push_event", test_push_event);
+	register_test("test_event_filter", test_event_filter);
+	register_test("test_event_state", test_event_state);
+	register_test("test_drop_payload", test_drop_payload);
+	register_test("test_error_ring", test_error_ring);
+	register_test("test_record_replay", test_record_replay);
+	register_test("test_joystick_stand_in", test_joystick_stand_in);
+	register_test("test_text_batching", test_text_batching);
+	register_test("test_window_state", test_window_state);
+	register_test("test_display_hotplug", test_display_hotplug);
 }
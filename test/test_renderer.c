@@ -1,8 +1,10 @@
 //	test_renderer.c
+#include <GLFW/glfw3.h>
 #include <sigtest.h>
 #include <stdio.h>
 #include "tinysdl.h"
 // internal
+#include "../src/internal/tsdl_gl.h"
 #include "../src/internal/tsdl_rendering.h"
 
 // Assert.isTrue(condition, "fail message");
@@ -24,8 +26,8 @@ void test_create_renderer(void)
     printf("\n");
     fflush(stdout);
 
-    Assert.isTrue(TinySDL.init_video(TSDL_INIT_VIDEO) == 0, "TinySDL init failed");
-    window win = TinySDL.createWindow("TinySDL Window", 0, 0, 800, 600, TSDL_WINDOW_SHOWN);
+    Assert.isTrue(TinySDL.init_video() == 0, "TinySDL init failed");
+    window win = TinySDL.window->create("TinySDL Window", 0, 0, 800, 600, TSDL_WINDOW_SHOWN);
 
     renderer r = create_renderer(win);
     Assert.isTrue(r != NULL, "Renderer creation failed");
@@ -33,8 +35,172 @@ void test_create_renderer(void)
     //  clean up renderer
     destroy_renderer(r);
 
-    //  clean up TinySDL
-    TinySDL.destroyWindow(win);
+    //  clean up TinySDL (destroys the active window)
+    TinySDL.quit();
+}
+
+//  batch untextured primitives into one draw call
+void test_renderer_batching(void)
+{
+    printf("\n");
+    fflush(stdout);
+
+    Assert.isTrue(TinySDL.init_video() == 0, "TinySDL init failed");
+    window win = TinySDL.window->create("TinySDL Window", 0, 0, 800, 600, TSDL_WINDOW_SHOWN);
+    Assert.isTrue(win != NULL, "TinySDL window create failed");
+
+    renderer r = create_renderer(win);
+    Assert.isTrue(r != NULL, "Renderer creation failed");
+
+    TSDL_Color red = {255, 0, 0, 255};
+    for (int i = 0; i < 1000; i++)
+    {
+        renderer_fillRect(r, (TSDL_Rect){(i % 80) * 10, (i / 80) * 10, 8, 8}, red);
+    }
+    renderer_drawLine(r, 0, 0, 800, 600, 2, red);
+    update_renderer(r);
+
+    TSDL_RendererStats stats = renderer_getStats(r);
+    Assert.isTrue(stats.quads == 1001, "Renderer dropped quads");
+    Assert.isTrue(stats.draw_calls == 1, "Same-state primitives should flush in one draw call");
+
+    //  clean up renderer
+    destroy_renderer(r);
+
+    //  clean up TinySDL (destroys the active window)
+    TinySDL.quit();
+}
+
+//  GL work queued to the render thread runs in submission order
+static void count_call(object user)
+{
+    (*(int *)user)++;
+}
+void test_render_thread(void)
+{
+    printf("\n");
+    fflush(stdout);
+
+    Assert.isTrue(TinySDL.init_video() == 0, "TinySDL init failed");
+    window win = TinySDL.window->create("TinySDL Window", 0, 0, 800, 600, TSDL_WINDOW_SHOWN);
+    Assert.isTrue(win != NULL, "TinySDL window create failed");
+    Assert.isTrue(tsdl_startRenderThread(win, 1) == TSDL_ERR_NONE, "Render thread start failed");
+
+    int calls = 0;
+    for (int frame = 0; frame < 3; frame++)
+    {
+        tsdl_clear(win);
+        for (int i = 0; i < 500; i++)
+        {
+            tsdl_runOnRenderThread(count_call, &calls);
+        }
+        tsdl_swapBuffers(win);
+    }
+
+    //  stopping drains the queue before joining
+    tsdl_stopRenderThread(win);
+    Assert.isTrue(calls == 1500, "Render thread dropped commands");
+
+    //  clean up TinySDL (destroys the active window)
+    TinySDL.quit();
+}
+
+//  full-height entries fill a page, spill to a new one, then evict the least recently used
+void test_atlas_eviction(void)
+{
+    printf("\n");
+    fflush(stdout);
+
+    Assert.isTrue(TinySDL.init_video() == 0, "TinySDL init failed");
+    window win = TinySDL.window->create("TinySDL Window", 0, 0, 800, 600, TSDL_WINDOW_SHOWN);
+    Assert.isTrue(win != NULL, "TinySDL window create failed");
+
+    //  63 + 1 padding fills a 64x64 page in both directions
+    atlas a = create_atlas(64, 64, 2);
+    Assert.isTrue(a != NULL, "Atlas creation failed");
+    TSDL_AtlasId first = atlas_add(a, 63, 63, NULL);
+    Assert.isTrue(first != 0, "Full-page entry rejected on a fresh page");
+    TSDL_AtlasId second = atlas_add(a, 63, 63, NULL);
+    Assert.isTrue(second != 0, "Full-page entry rejected on a new page");
+
+    TSDL_AtlasRegion region;
+    Assert.isTrue(atlas_get(a, first, &region), "First entry should still resolve");
+    Assert.isTrue(region.x == 0 && region.y == 0, "First entry misplaced");
+
+    //  only the second page is used this frame, so the first is evicted
+    atlas_nextFrame(a);
+    Assert.isTrue(atlas_get(a, second, NULL), "Second entry should still resolve");
+    TSDL_AtlasId third = atlas_add(a, 63, 63, NULL);
+    Assert.isTrue(third != 0, "Full-page entry rejected on an evicted page");
+    Assert.isFalse(atlas_get(a, first, NULL), "Evicted entry should go stale");
+    Assert.isTrue(atlas_get(a, second, NULL), "Entry on the used page was evicted");
+    Assert.isTrue(atlas_get(a, third, &region), "New entry should resolve");
+    Assert.isTrue(region.x == 0 && region.y == 0, "New entry should reuse the evicted page");
+
+    //  every page is used this frame now; nothing can be evicted
+    Assert.isTrue(atlas_add(a, 63, 63, NULL) == 0, "Atlas evicted a page in use this frame");
+    Assert.isTrue(atlas_get(a, second, NULL) && atlas_get(a, third, NULL), "Failed add invalidated live entries");
+
+    destroy_atlas(a);
+
+    //  clean up TinySDL (destroys the active window)
+    TinySDL.quit();
+}
+
+//  repeated binds and sets reach the driver once; a context switch forgets them
+void test_glstate_skips(void)
+{
+    printf("\n");
+    fflush(stdout);
+
+    Assert.isTrue(TinySDL.init_video() == 0, "TinySDL init failed");
+    window win = TinySDL.window->create("TinySDL Window", 0, 0, 800, 600, TSDL_WINDOW_SHOWN);
+    Assert.isTrue(win != NULL, "TinySDL window create failed");
+
+    glstate_invalidate();
+    tsdl_resetGLStateStats();
+    for (int i = 0; i < 3; i++)
+    {
+        glstate_useProgram(0);
+        glstate_bindVertexArray(0);
+        glstate_bindTexture(GL_TEXTURE_2D, 0);
+        glstate_clearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    }
+    TSDL_GLStateStats stats = tsdl_getGLStateStats();
+    Assert.isTrue(stats.issued == 4, "First calls should reach the driver");
+    Assert.isTrue(stats.skipped == 8, "Repeated calls should be skipped");
+
+    //  a changed value is issued; after invalidating, the same value is issued again
+    glstate_clearColor(1.0f, 0.0f, 0.0f, 1.0f);
+    glstate_invalidate();
+    glstate_clearColor(1.0f, 0.0f, 0.0f, 1.0f);
+    stats = tsdl_getGLStateStats();
+    Assert.isTrue(stats.issued == 6 && stats.skipped == 8, "Changed or forgotten state was skipped");
+
+    //  clean up TinySDL (destroys the active window)
+    TinySDL.quit();
+}
+
+//  modifier keys still map once the render thread has taken the window's context
+void test_render_thread_mods(void)
+{
+    printf("\n");
+    fflush(stdout);
+
+    Assert.isTrue(TinySDL.init_video() == 0, "TinySDL init failed");
+    window win = TinySDL.window->create("TinySDL Window", 0, 0, 800, 600, TSDL_WINDOW_SHOWN);
+    Assert.isTrue(win != NULL, "TinySDL window create failed");
+    Assert.isTrue(tsdl_startRenderThread(win, 1) == TSDL_ERR_NONE, "Render thread start failed");
+
+    //  no context is current on this thread now; a held modifier must not need one
+    int mods = map_key_mods(GLFW_MOD_SHIFT | GLFW_MOD_CONTROL);
+    Assert.isTrue(mods & (TSDL_MOD_LSHIFT | TSDL_MOD_RSHIFT), "Shift lost with the render thread running");
+    Assert.isTrue(mods & (TSDL_MOD_LCTRL | TSDL_MOD_RCTRL), "Control lost with the render thread running");
+    Assert.isTrue(map_key_mods(0) == TSDL_MOD_NONE, "Modifiers reported with none held");
+
+    tsdl_stopRenderThread(win);
+
+    //  clean up TinySDL (destroys the active window)
     TinySDL.quit();
 }
 
@@ -43,4 +209,9 @@ __attribute__((constructor)) void init_sigtest_tests(void)
 {
     register_test("setup_test", setup_test);
     register_test("test_create_renderer", test_create_renderer);
+    register_test("test_renderer_batching", test_renderer_batching);
+    register_test("test_render_thread", test_render_thread);
+    register_test("test_render_thread_mods", test_render_thread_mods);
+    register_test("test_atlas_eviction", test_atlas_eviction);
+    register_test("test_glstate_skips", test_glstate_skips);
 }
\ No newline at end of file